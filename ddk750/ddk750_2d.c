@@ -1019,6 +1019,78 @@ long deSystemMem2VideoMemBusMasterBlt(
     return 0;
 }
 
+/*
+ * Video Memory to System Memory data transfer.
+ * The 2D engine writes the destination through the PCI Master window,
+ * setPCIMasterBaseAddress() must be called first and dBase is the
+ * remaining address it returned. Only works in D, S, ~D, and ~S ROP.
+ */
+long deVideoMem2SystemMemBusMasterBlt(
+    unsigned long sBase,    /* Address of source: offset in frame buffer */
+    unsigned long sPitch,   /* Pitch value of source surface in BYTE */
+    unsigned long sx,
+    unsigned long sy,       /* Starting coordinate of source surface */
+    unsigned long dBase,    /* Address of destination: offset from the PCI Master base */
+    unsigned long dPitch,   /* Pitch value of destination surface in BYTE */
+    unsigned long bpp,      /* Color depth of destination surface */
+    unsigned long dx,
+    unsigned long dy,       /* Starting coordinate of destination surface */
+    unsigned long width, 
+    unsigned long height,   /* width and height of rectangle in pixel value */
+    unsigned long rop2      /* ROP value */
+)
+{
+    unsigned long de_ctrl, bytePerPixel;
+
+    if (deWaitForNotBusy() != 0)
+        return -1;
+
+    bytePerPixel = bpp/8;
+
+    /* 2D Source Base: local memory */
+    POKE_32(DE_WINDOW_SOURCE_BASE,
+        FIELD_SET  (0, DE_WINDOW_SOURCE_BASE, EXT, LOCAL) |
+        FIELD_VALUE(0, DE_WINDOW_SOURCE_BASE, ADDRESS, sBase));
+
+    /* 2D Destination Base: system memory behind the PCI Master base */
+    POKE_32(DE_WINDOW_DESTINATION_BASE,
+        FIELD_SET  (0, DE_WINDOW_DESTINATION_BASE, EXT, EXTERNAL) |
+        FIELD_VALUE(0, DE_WINDOW_DESTINATION_BASE, ADDRESS, dBase));
+
+    POKE_32(DE_PITCH,
+        FIELD_VALUE(0, DE_PITCH, DESTINATION, (dPitch/bytePerPixel)) |
+        FIELD_VALUE(0, DE_PITCH, SOURCE,      (sPitch/bytePerPixel)));
+
+    POKE_32(DE_WINDOW_WIDTH,
+        FIELD_VALUE(0, DE_WINDOW_WIDTH, DESTINATION, (dPitch/bytePerPixel)) |
+        FIELD_VALUE(0, DE_WINDOW_WIDTH, SOURCE,      (sPitch/bytePerPixel)));
+
+    deSetPixelFormat(bpp);
+
+    POKE_32(DE_SOURCE,
+        FIELD_SET  (0, DE_SOURCE, WRAP, DISABLE) |
+        FIELD_VALUE(0, DE_SOURCE, X_K1, sx)   |
+        FIELD_VALUE(0, DE_SOURCE, Y_K2, sy));
+    POKE_32(DE_DESTINATION,
+        FIELD_SET  (0, DE_DESTINATION, WRAP, DISABLE) |
+        FIELD_VALUE(0, DE_DESTINATION, X,    dx)  |
+        FIELD_VALUE(0, DE_DESTINATION, Y,    dy));
+    POKE_32(DE_DIMENSION,
+        FIELD_VALUE(0, DE_DIMENSION, X,    width) |
+        FIELD_VALUE(0, DE_DIMENSION, Y_ET, height));
+
+    de_ctrl = 
+        FIELD_VALUE(0, DE_CONTROL, ROP, rop2) |
+        FIELD_SET(0, DE_CONTROL, ROP_SELECT, ROP2) |
+        FIELD_SET(0, DE_CONTROL, COMMAND, BITBLT) |
+        FIELD_SET(0, DE_CONTROL, DIRECTION, LEFT_TO_RIGHT) |
+        FIELD_SET(0, DE_CONTROL, STATUS, START);
+
+    POKE_32(DE_CONTROL, de_ctrl | deGetTransparency());
+
+    return 0;
+}
+
 /* 
  * System memory to Video memory data transfer
  * Note: 
@@ -140,6 +140,25 @@ long deSystemMem2VideoMemBusMasterBlt(
     unsigned long rop2      /* ROP value */
 );
 
+/*
+ * Video Memory to System Memory data transfer through the PCI Master
+ * window. dBase is relative to the base set by setPCIMasterBaseAddress().
+ */
+long deVideoMem2SystemMemBusMasterBlt(
+    unsigned long sBase,    /* Address of source: offset in frame buffer */
+    unsigned long sPitch,   /* Pitch value of source surface in BYTE */
+    unsigned long sx,
+    unsigned long sy,       /* Starting coordinate of source surface */
+    unsigned long dBase,    /* Address of destination: offset from the PCI Master base */
+    unsigned long dPitch,   /* Pitch value of destination surface in BYTE */
+    unsigned long bpp,      /* Color depth of destination surface */
+    unsigned long dx,
+    unsigned long dy,       /* Starting coordinate of destination surface */
+    unsigned long width, 
+    unsigned long height,   /* width and height of rectangle in pixel value */
+    unsigned long rop2      /* ROP value */
+);
+
 /* 
  * System memory to Video memory data transfer
  * Note: 
@@ -1,32 +1,36 @@
 #ifndef DDK750_HELP_H__
 #define DDK750_HELP_H__
 #include "ddk750_chip.h"
-#ifndef USE_INTERNAL_REGISTER_ACCESS
 
 #include <linux/ioport.h>
 #include <linux/io.h>
 #include <linux/uaccess.h>
 #include "ddk750_mode.h"
 
+#ifndef USE_INTERNAL_REGISTER_ACCESS
 
 #define PEEK32(addr) readl((addr)+mmio750)
 #define POKE32(addr,data) writel((data),(addr)+mmio750)
-#define peekRegisterDWord PEEK32
-#define pokeRegisterDWord POKE32
-
 
 #define peekRegisterByte(addr) readb((addr)+mmio750)
 #define pokeRegisterByte(addr,data) writeb((data),(addr)+mmio750)
 
+#else
+#include "../smi_regs.h"
+
+#define PEEK32(addr) SMI_REG_READ32(mmio750, (addr))
+#define POKE32(addr,data) SMI_REG_WRITE32(mmio750, (addr), (data))
+
+#define peekRegisterByte(addr) SMI_REG_READ8(mmio750, (addr))
+#define pokeRegisterByte(addr,data) SMI_REG_WRITE8(mmio750, (addr), (data))
+#endif
+
+#define peekRegisterDWord PEEK32
+#define pokeRegisterDWord POKE32
 
 
 extern volatile unsigned  char __iomem * mmio750;
 
 void ddk750_set_mmio(volatile unsigned char *,unsigned short,char);
 
-#else
-/* implement if you want use it*/
-#endif
-
 #endif
-
@@ -1,15 +1,11 @@
 #ifndef _DDK768_HELP_H__
 #define _DDK768_HELP_H__
 
-#ifndef USE_INTERNAL_REGISTER_ACCESS
-
 #include <linux/ioport.h>
 #include <linux/io.h>
 #include <linux/uaccess.h>
 
-
-
-
+#ifndef USE_INTERNAL_REGISTER_ACCESS
 
 #define peekRegisterDWord(addr) readl((addr)+mmio768)
 #define pokeRegisterDWord(addr,data) writel((data),(addr)+mmio768)
@@ -17,6 +13,16 @@
 #define peekRegisterByte(addr) readb((addr)+mmio768)
 #define pokeRegisterByte(addr,data) writeb((data),(addr)+mmio768)
 
+#else
+#include "../smi_regs.h"
+
+#define peekRegisterDWord(addr) SMI_REG_READ32(mmio768, (addr))
+#define pokeRegisterDWord(addr,data) SMI_REG_WRITE32(mmio768, (addr), (data))
+
+#define peekRegisterByte(addr) SMI_REG_READ8(mmio768, (addr))
+#define pokeRegisterByte(addr,data) SMI_REG_WRITE8(mmio768, (addr), (data))
+#endif
+
 
 /* Size of SM768 MMIO and memory */
 #define SM768_PCI_ALLOC_MMIO_SIZE       (2*1024*1024)
@@ -27,8 +33,4 @@ void ddk768_set_mmio(volatile unsigned char * addr,unsigned short devId,char rev
 
 extern volatile unsigned  char __iomem * mmio768;
 
-#else
-/* implement if you want use it*/
-#endif
-
 #endif
@@ -674,6 +674,17 @@ mode_parameter_t ddk768_getCurrentModeParam(disp_control_t dispCtrl)
 		return gChannel1CurrentModeParam;
 }
 
+/* 
+ * This function records the mode a channel is running without programming it.
+ */
+void ddk768_setCurrentModeParam(disp_control_t dispCtrl, mode_parameter_t *pModeParam)
+{
+	if (dispCtrl == CHANNEL0_CTRL)
+		gChannel0CurrentModeParam = *pModeParam;
+	else
+		gChannel1CurrentModeParam = *pModeParam;
+}
+
 /*
  *  addTiming
  *      This function adds the SM750 mode parameter timing to the specified mode table
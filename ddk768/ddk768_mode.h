@@ -146,6 +146,15 @@ mode_parameter_t ddk768_getCurrentModeParam(
     disp_control_t dispCtrl
 );
 
+/* 
+ * This function records the mode a channel is running without programming it,
+ * e.g. a timing inherited from the VBIOS.
+ */
+void ddk768_setCurrentModeParam(
+    disp_control_t dispCtrl,
+    mode_parameter_t *pModeParam
+);
+
 /*
  *  getMaximumModeEntries
  *      This function gets the maximum entries that can be stored in the mode table.
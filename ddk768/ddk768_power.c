@@ -227,7 +227,7 @@ __attribute__((unused)) static void ddk768_enableARM(unsigned long enable)
 /*
  *	Enable/disable display control 0
  */ 
-__attribute__((unused)) static void ddk768_enableDC0(unsigned long enable)
+void ddk768_enableDC0(unsigned long enable)
 {
     unsigned long regValue;
 
@@ -243,7 +243,7 @@ __attribute__((unused)) static void ddk768_enableDC0(unsigned long enable)
 /*
  *	Enable/disable display control 1
  */ 
-__attribute__((unused)) static void ddk768_enableDC1(unsigned long enable)
+void ddk768_enableDC1(unsigned long enable)
 {
     unsigned long regValue;
 
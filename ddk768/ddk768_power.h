@@ -46,6 +46,16 @@ void ddk768_enableHDMI(unsigned long enable);
 
 void ddk768_enableI2S(unsigned long enable);
 
+/*
+ *	Enable/disable display control 0
+ */ 
+void ddk768_enableDC0(unsigned long enable);
+
+/*
+ *	Enable/disable display control 1
+ */ 
+void ddk768_enableDC1(unsigned long enable);
+
 
 
 #endif /* _POWER_H_ */
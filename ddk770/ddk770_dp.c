@@ -21,6 +21,9 @@
 #endif
 
 dp_info g_dp_info[2] = { {0}, {0} };
+static dp_train_cache g_dp_train_cache[2] = { {0}, {0} };
+/* AUX transactions issued per port, including deferred retries */
+static unsigned long g_dp_aux_count[2] = { 0, 0 };
 
 unsigned int pll_table[][4] = {
 	    /* prediv, fbdiv, postdiv, clkdiv_16m */
@@ -101,6 +104,8 @@ static unsigned int DP_Aux_Channel_Run(dp_index index, struct aux_cfg *aux_get_r
 {
 	unsigned int ret = 0;
 
+	g_dp_aux_count[index]++;
+
 	ret = DP_Aux_Write(index, aux_get_rx->aux_cmd,
 			aux_get_rx->dpcd_addr, aux_get_rx->wr_buff,
 			aux_get_rx->length);
@@ -493,12 +498,12 @@ static void DP_Tu_Init(dp_index index)
 				FIELD_VALUE(0, DP_CONTROLLER220, REG_AVG_PER_TU_FRAC, tu_frac));
 }
 
-static unsigned char DP_Link_Status(const unsigned char link_status[DP_LINK_STATUS_SIZE], int r)
+static unsigned char DP_Link_Status(const unsigned char link_status[DP_LINK_STATUS_ADJUST_SIZE], int r)
 {
 	return link_status[r - DP_LANE0_1_STATUS];
 }
 
-static unsigned char DP_Get_Lane_Status(const unsigned char link_status[DP_LINK_STATUS_SIZE],
+static unsigned char DP_Get_Lane_Status(const unsigned char link_status[DP_LINK_STATUS_ADJUST_SIZE],
 			     int lane)
 {
 	int i = DP_LANE0_1_STATUS + (lane >> 1);
@@ -508,7 +513,7 @@ static unsigned char DP_Get_Lane_Status(const unsigned char link_status[DP_LINK_
 	return (l >> s) & 0xf;
 }
 
-static unsigned char DP_Get_Adjust_Request_Voltage(const unsigned char link_status[DP_LINK_STATUS_SIZE],
+static unsigned char DP_Get_Adjust_Request_Voltage(const unsigned char link_status[DP_LINK_STATUS_ADJUST_SIZE],
 				     int lane)
 {
 	int i = DP_ADJUST_REQUEST_LANE0_1 + (lane >> 1);
@@ -520,7 +525,7 @@ static unsigned char DP_Get_Adjust_Request_Voltage(const unsigned char link_stat
 	return ((l >> s) & 0x3) << DP_TRAIN_VOLTAGE_SWING_SHIFT;
 }
 
-static unsigned char DP_Get_Adjust_Request_Pre_Emphasis(const unsigned char link_status[DP_LINK_STATUS_SIZE],
+static unsigned char DP_Get_Adjust_Request_Pre_Emphasis(const unsigned char link_status[DP_LINK_STATUS_ADJUST_SIZE],
 					  int lane)
 {
 	int i = DP_ADJUST_REQUEST_LANE0_1 + (lane >> 1);
@@ -532,7 +537,7 @@ static unsigned char DP_Get_Adjust_Request_Pre_Emphasis(const unsigned char link
 	return ((l >> s) & 0x3) << DP_TRAIN_PRE_EMPHASIS_SHIFT;
 }
 
-static bool DP_Clk_Recovery_OK(const unsigned char link_status[DP_LINK_STATUS_SIZE],
+static bool DP_Clk_Recovery_OK(const unsigned char link_status[DP_LINK_STATUS_ADJUST_SIZE],
 			      int lane_count)
 {
 	int lane;
@@ -546,7 +551,7 @@ static bool DP_Clk_Recovery_OK(const unsigned char link_status[DP_LINK_STATUS_SI
 	return true;
 }
 
-static bool DP_Channel_EQ_OK(const unsigned char link_status[DP_LINK_STATUS_SIZE],
+static bool DP_Channel_EQ_OK(const unsigned char link_status[DP_LINK_STATUS_ADJUST_SIZE],
 			  int lane_count)
 {
 	unsigned char lane_align;
@@ -572,12 +577,15 @@ DP_Enhanced_Frame_Cap(const unsigned char dpcd[DP_RECEIVER_CAP_SIZE])
 		(dpcd[DP_MAX_LANE_COUNT] & DP_ENHANCED_FRAME_CAP);
 }
 
+/*
+ * link_status holds DP_LINK_STATUS_ADJUST_SIZE bytes from DP_LANE0_1_STATUS,
+ * so the post-cursor2 request comes with the same AUX transaction.
+ */
 static void DP_Get_Adjust_Train(dp_index index,
-		const unsigned char link_status[DP_LINK_STATUS_SIZE])
+		const unsigned char link_status[DP_LINK_STATUS_ADJUST_SIZE])
 {
-	unsigned char post_cursor;
+	unsigned char post_cursor = DP_Link_Status(link_status, DP_ADJUST_REQUEST_POST_CURSOR2);
 	int lane;
-	DP_DPCD_Read(index, DP_ADJUST_REQUEST_POST_CURSOR2, &post_cursor, sizeof(post_cursor));
 
 	for (lane = 0; lane < g_dp_info[index].lane_count; lane++) {
 		g_dp_info[index].swing[lane] = DP_Get_Adjust_Request_Voltage(link_status, lane);
@@ -586,10 +594,29 @@ static void DP_Get_Adjust_Train(dp_index index,
 	}
 }
 
-static void DP_Voltage_Swing_Adjust(dp_index index)
+static void DP_Train_Set_Build(dp_index index, unsigned char train_set[4])
 {
-	unsigned char train_set[4];
-	int i, lane;
+	int lane;
+
+	for (lane = 0; lane < 4; lane++) {
+		train_set[lane] = 0;
+		if (lane >= g_dp_info[index].lane_count)
+			continue;
+
+		train_set[lane] = g_dp_info[index].swing[lane];
+		if (g_dp_info[index].swing[lane] >= DP_TRAIN_VOLTAGE_SWING_LEVEL_2)
+			train_set[lane] |= DP_TRAIN_MAX_SWING_REACHED;
+
+		train_set[lane] |= (g_dp_info[index].preem[lane]);
+		if (g_dp_info[index].preem[lane] >= DP_TRAIN_PRE_EMPH_LEVEL_2)
+			train_set[lane] |= DP_TRAIN_MAX_PRE_EMPHASIS_REACHED;
+	}
+}
+
+static void DP_Post_Cursor_Set(dp_index index)
+{
+	unsigned char train_set[2];
+	int i;
 
 	/* FROM KERNEL CODE!!! write currently selected post-cursor level (if supported) */
 	if (g_dp_info[index].dpcd_rev >= 0x12 && g_dp_info[index].lane_rate == DP_LINK_BW_5_4)
@@ -602,17 +629,15 @@ static void DP_Voltage_Swing_Adjust(dp_index index)
 		DP_DPCD_Write(index, DP_TRAINING_LANE0_1_SET2, train_set,
 								(((g_dp_info[index].lane_count) + (2) - 1) / (2)));
 	}
+}
 
-	for (lane = 0; lane < g_dp_info[index].lane_count; lane++) {
-		train_set[lane] = g_dp_info[index].swing[lane];
-		if (g_dp_info[index].swing[lane] >= DP_TRAIN_VOLTAGE_SWING_LEVEL_2)
-			train_set[lane] |= DP_TRAIN_MAX_SWING_REACHED;
+static void DP_Voltage_Swing_Adjust(dp_index index)
+{
+	unsigned char train_set[4];
 
-		train_set[lane] |= (g_dp_info[index].preem[lane]);
-		if (g_dp_info[index].preem[lane] >= DP_TRAIN_PRE_EMPH_LEVEL_2)
-			train_set[lane] |= DP_TRAIN_MAX_PRE_EMPHASIS_REACHED;
-	}
+	DP_Post_Cursor_Set(index);
 
+	DP_Train_Set_Build(index, train_set);
 	DP_DPCD_Write(index, DP_TRAINING_LANE0_SET,
 		train_set, g_dp_info[index].lane_count);
 }
@@ -684,28 +709,35 @@ static void DP_EDP_Rate_Set(dp_index index)
 	}
 }
 
-static void DP_CDR_Training(dp_index index)
+/*
+ * Program link rate, lane count, training pattern, drive levels and
+ * downspread/coding (DPCD 0x100-0x108) with one 9-byte AUX write instead
+ * of a request per field.
+ */
+static void DP_Link_Train_Start(dp_index index, unsigned char pattern)
 {
-    int i = 0;
-    //unsigned int  value;
-    unsigned char link_cfg[2];
-    unsigned char link_status[DP_LINK_STATUS_SIZE];
-
-    DP_Training_Pattern_Set(index, DP_TRAINING_PATTERN_1);
+    unsigned char link_cfg[DP_DOWNSPREAD_CTRL - DP_LINK_BW_SET + 2];
 
     DP_EDP_Rate_Set(index);
+    DP_Post_Cursor_Set(index);
 
-    /* Write the link configuration data */
     link_cfg[0] = g_dp_info[index].lane_rate;
     link_cfg[1] = g_dp_info[index].lane_count | (g_dp_info[index].enhance_mode << 7); /* DP_LANE_COUNT_SET */
-    DP_DPCD_Write(index, DP_LINK_BW_SET, link_cfg, 2);
+    link_cfg[2] = pattern; /* DP_TRAINING_PATTERN_SET */
+    DP_Train_Set_Build(index, &link_cfg[DP_TRAINING_LANE0_SET - DP_LINK_BW_SET]);
+    link_cfg[DP_DOWNSPREAD_CTRL - DP_LINK_BW_SET] = 0;
+    link_cfg[DP_DOWNSPREAD_CTRL - DP_LINK_BW_SET + 1] = DP_DP_PHY108_SET_ANSI_8B10B;
+    DP_DPCD_Write(index, DP_LINK_BW_SET, link_cfg, sizeof(link_cfg));
+}
+
+static void DP_CDR_Training(dp_index index)
+{
+    int i = 0;
+    unsigned char link_status[DP_LINK_STATUS_ADJUST_SIZE];
 
-    link_cfg[0] = 0;
-	link_cfg[1] = DP_DP_PHY108_SET_ANSI_8B10B;
-	DP_DPCD_Write(index, DP_DOWNSPREAD_CTRL, link_cfg, 2);
+    DP_Training_Pattern_Set(index, DP_TRAINING_PATTERN_1);
 
-    link_cfg[0] = DP_TRAINING_PATTERN_1; /* DP_TRAINING_PATTERN_SET */
-	DP_DPCD_Write(index, DP_TRAINING_PATTERN_SET, link_cfg, 1);
+    DP_Link_Train_Start(index, DP_TRAINING_PATTERN_1);
 
     if (g_dp_info[index].cdr_delay <= 0)
 		g_dp_info[index].cdr_delay = 4;
@@ -717,7 +749,7 @@ static void DP_CDR_Training(dp_index index)
 		usleep_range(g_dp_info[index].cdr_delay * 1000, g_dp_info[index].cdr_delay * 1100);
 
 		if (DP_DPCD_Read(index, DP_LANE0_1_STATUS, link_status,
-			DP_LINK_STATUS_SIZE) != DP_LINK_STATUS_SIZE) {
+			DP_LINK_STATUS_ADJUST_SIZE) != DP_LINK_STATUS_ADJUST_SIZE) {
 			return;
 		}
 
@@ -736,7 +768,7 @@ static void DP_EQ_Training(dp_index index)
 {
 	int i = 0, delay = 0;
 	unsigned char link_cfg[2];
-	unsigned char link_status[DP_LINK_STATUS_SIZE];
+	unsigned char link_status[DP_LINK_STATUS_ADJUST_SIZE];
 
 	DP_Training_Pattern_Set(index, DP_TRAINING_PATTERN_2);
 
@@ -755,7 +787,7 @@ static void DP_EQ_Training(dp_index index)
 		usleep_range(delay*1000, delay*1100);
 
         if (DP_DPCD_Read(index, DP_LANE0_1_STATUS, link_status,
-			DP_LINK_STATUS_SIZE) != DP_LINK_STATUS_SIZE) {
+			DP_LINK_STATUS_ADJUST_SIZE) != DP_LINK_STATUS_ADJUST_SIZE) {
 			return;
 		}
 
@@ -783,9 +815,9 @@ static void DP_Link_Start(dp_index index)
 	DP_DPCD_Write(index, DP_TRAINING_PATTERN_SET, link_cfg, 1);
 }
 
-static int DP_Sink_Lane_Status_Get(dp_index index, unsigned char status[DP_LINK_STATUS_SIZE])
+static int DP_Sink_Lane_Status_Get(dp_index index, unsigned char status[DP_LINK_STATUS_ADJUST_SIZE])
 {
-	if (DP_DPCD_Read(index, DP_LANE0_1_STATUS, status, DP_LINK_STATUS_SIZE) == DP_LINK_STATUS_SIZE)
+	if (DP_DPCD_Read(index, DP_LANE0_1_STATUS, status, DP_LINK_STATUS_ADJUST_SIZE) == DP_LINK_STATUS_ADJUST_SIZE)
 		return 0;
 
 	return -1;
@@ -853,7 +885,7 @@ static unsigned char DP_Check_Sink_Power(dp_index index)
 }
 static int DP_Link_Train_Lock(dp_index index)
 {
-	unsigned char link_status[DP_LINK_STATUS_SIZE];
+	unsigned char link_status[DP_LINK_STATUS_ADJUST_SIZE];
 
 	if (!DP_Sink_Lane_Status_Get(index, link_status) &&
         (!DP_Clk_Recovery_OK(link_status, g_dp_info[index].lane_count) || !DP_Channel_EQ_OK(link_status, g_dp_info[index].lane_count)))
@@ -877,10 +909,101 @@ int DP_Check_Sink_Status(dp_index index)
 
 	return 0;
 }
+static void DP_Train_Cache_Invalidate(dp_index index)
+{
+	g_dp_train_cache[index].valid = 0;
+}
+
+static bool DP_Train_Cache_Match(dp_index index)
+{
+	dp_train_cache *cache = &g_dp_train_cache[index];
+
+	return cache->valid &&
+		cache->edid_sum == g_dp_info[index].edid_sum &&
+		!memcmp(cache->dpcd, g_dp_info[index].dpcd, DP_RECEIVER_CAP_SIZE);
+}
+
+static void DP_Train_Cache_Save(dp_index index)
+{
+	dp_train_cache *cache = &g_dp_train_cache[index];
+
+	memcpy(cache->dpcd, g_dp_info[index].dpcd, DP_RECEIVER_CAP_SIZE);
+	cache->edid_sum = g_dp_info[index].edid_sum;
+	cache->lane_rate = g_dp_info[index].lane_rate;
+	cache->lane_count = g_dp_info[index].lane_count;
+	cache->phy_rate = g_dp_info[index].phy_rate;
+	cache->phy_lanes = g_dp_info[index].phy_lanes;
+	memcpy(cache->swing, g_dp_info[index].swing, sizeof(cache->swing));
+	memcpy(cache->preem, g_dp_info[index].preem, sizeof(cache->preem));
+	memcpy(cache->pcursor, g_dp_info[index].pcursor, sizeof(cache->pcursor));
+	cache->valid = 1;
+}
+
+/*
+ * Replay the last known-good link parameters and only check the sink
+ * once per pattern instead of walking the CR/EQ adjust loops. Returns
+ * false when the sink does not lock, the caller then does a full train.
+ */
+static bool DP_Fast_Train(dp_index index)
+{
+	dp_train_cache *cache = &g_dp_train_cache[index];
+	unsigned char link_cfg[1];
+	unsigned char link_status[DP_LINK_STATUS_ADJUST_SIZE];
+	int delay;
+
+	if (g_dp_info[index].lane_rate != cache->lane_rate ||
+		g_dp_info[index].lane_count != cache->lane_count) {
+		g_dp_info[index].lane_rate = cache->lane_rate;
+		g_dp_info[index].lane_count = cache->lane_count;
+		g_dp_info[index].phy_rate = cache->phy_rate;
+		g_dp_info[index].phy_lanes = cache->phy_lanes;
+		DP_Link_Cfg(index);
+	}
+	memcpy(g_dp_info[index].swing, cache->swing, sizeof(cache->swing));
+	memcpy(g_dp_info[index].preem, cache->preem, sizeof(cache->preem));
+	memcpy(g_dp_info[index].pcursor, cache->pcursor, sizeof(cache->pcursor));
+
+	delay = (g_dp_info[index].dpcd[DP_TRAINING_AUX_RD_INTERVAL] & 0x7f) * 4;
+	if (delay <= 0)
+		delay = 4;
+
+	DP_Training_Pattern_Set(index, DP_TRAINING_PATTERN_1);
+	DP_Link_Train_Start(index, DP_TRAINING_PATTERN_1);
+
+	usleep_range(delay * 1000, delay * 1100);
+	if (DP_Sink_Lane_Status_Get(index, link_status) ||
+		!DP_Clk_Recovery_OK(link_status, g_dp_info[index].lane_count))
+		return false;
+
+	DP_Training_Pattern_Set(index, DP_TRAINING_PATTERN_2);
+	link_cfg[0] = DP_TRAINING_PATTERN_2;
+	DP_DPCD_Write(index, DP_TRAINING_PATTERN_SET, link_cfg, 1);
+
+	usleep_range(delay * 1000, delay * 1100);
+	if (DP_Sink_Lane_Status_Get(index, link_status) ||
+		!DP_Channel_EQ_OK(link_status, g_dp_info[index].lane_count))
+		return false;
+
+	DP_Link_Start(index);
+
+	return DP_Link_Train_Lock(index);
+}
+
 static int DP_Link_Train(dp_index index)
 {
     int retry_count = 0;
 
+    if (DP_HPD_Detect(index) && DP_Train_Cache_Match(index)) {
+        printk("dp[%d] Fast Training. rate[%x] count[%x]\n", index,
+               g_dp_train_cache[index].lane_rate, g_dp_train_cache[index].lane_count);
+        if (DP_Fast_Train(index))
+            return DP_SUCCESS;
+
+        printk("dp[%d] fast train fail, full training\n", index);
+        DP_Train_Cache_Invalidate(index);
+        DP_Link_Cfg(index);
+    }
+
 RETRY:
     if (!DP_HPD_Detect(index))
     {
@@ -906,6 +1029,8 @@ RETRY:
                 goto RETRY;
             }
         }
+    } else {
+        DP_Train_Cache_Save(index);
     }
 
 	return DP_SUCCESS;
@@ -1123,56 +1248,54 @@ END:
 	return error;
 }
 
+/*
+ * Read the EDID over I2C-over-AUX. Each block is addressed through the
+ * E-DDC segment pointer (0x30) and the word offset (0x50), then fetched
+ * in DP_AUX_MAX_PAYLOAD_BYTES bursts unless the caller asks for single
+ * byte reads as a fallback for picky sinks.
+ */
 static int DP_Read_EDID_IIC_Aux(dp_index index, unsigned char *pEDIDBuffer, unsigned short *pBufferSize, bool sigleByte)
 {
-	int ret = 0, blockCount = 1, i,j;
-	int lenLeft = DP_EDID_BUF_LEN;
-	unsigned char val[16] = { 0 };
-
-	/* Send a bare address packet to start the transaction.
-	 * Zero sized messages specify an address only (bare
-	 * address) transaction.
-	 */
-	DP_Aux_Transfer(index, DP_AUX_I2C_WRITE, 0x50, NULL, 0);
+	int ret = 0, blockCount = 1, i;
+	int burst = sigleByte ? 1 : DP_AUX_MAX_PAYLOAD_BYTES;
+	unsigned char segment, offset;
 
 	for (i = 0; i < blockCount; i++)
 	{
-		lenLeft = DP_EDID_BUF_LEN;
+		segment = i >> 1;
+		offset = (i & 1) * DP_EDID_BUF_LEN;
+
+		/* Only E-DDC sinks decode the segment pointer, skip it for block 0/1 */
+		if (segment &&
+			DP_Aux_Transfer(index, DP_AUX_I2C_WRITE | DP_AUX_I2C_MOT, DP_DDC_SEGMENT_ADDR, &segment, 1) < 0)
+			goto ERR;
+
+		if (DP_Aux_Transfer(index, DP_AUX_I2C_WRITE | DP_AUX_I2C_MOT, DP_DDC_ADDR, &offset, 1) < 0)
+			goto ERR;
+
 		do
 		{
-			if (lenLeft < DP_AUX_MAX_PAYLOAD_BYTES || sigleByte)
-			{
-				ret = DP_Aux_Transfer(index, DP_AUX_I2C_READ, 0x50, val, 1);
-				if (ret <= 0 || ret > DP_AUX_MAX_PAYLOAD_BYTES)
-					goto ERR;
-			}else{
-				ret = DP_Aux_Transfer(index, DP_AUX_I2C_READ, 0x50, val, DP_AUX_MAX_PAYLOAD_BYTES);
-				if (ret <= 0 || ret > DP_AUX_MAX_PAYLOAD_BYTES)
-					goto ERR;
-			}
-
-			for (j = 0; j < ret; j++)
-				pEDIDBuffer[j + *pBufferSize] = val[j];
+			ret = DP_Aux_Transfer(index, DP_AUX_I2C_READ | DP_AUX_I2C_MOT, DP_DDC_ADDR,
+					pEDIDBuffer + *pBufferSize, burst);
+			if (ret <= 0 || ret > DP_AUX_MAX_PAYLOAD_BYTES)
+				goto ERR;
 
 			*pBufferSize += ret;
-			lenLeft = DP_EDID_BUF_LEN * (i + 1) - *pBufferSize;
-		} while (lenLeft > 0);
+		} while (*pBufferSize < DP_EDID_BUF_LEN * (i + 1));
 
-		blockCount = pEDIDBuffer[126] + 1;
-		if (*pBufferSize % DP_EDID_BUF_LEN != 0)
-			goto ERR;
-		if (DP_EDID_Is_Invalid(pEDIDBuffer, *pBufferSize / DP_EDID_BUF_LEN))
+		/* Close the transaction so the segment pointer resets to 0 */
+		DP_Aux_Transfer(index, DP_AUX_I2C_WRITE & ~DP_AUX_I2C_MOT, DP_DDC_ADDR, NULL, 0);
+
+		if (DP_EDID_Is_Invalid(pEDIDBuffer + DP_EDID_BUF_LEN * i, i + 1))
 			goto ERR;
+
+		if (i == 0)
+			blockCount = min1(pEDIDBuffer[126] + 1, DP_EDID_MAX_BLOCKS);
 	}
 
-	/* Send a bare address packet to close out the transaction.
-	 * Zero sized messages specify an address only (bare
-	 * address) transaction.
-	 */
-	DP_Aux_Transfer(index, DP_AUX_I2C_WRITE & ~DP_AUX_I2C_MOT, 0x50, NULL, 0);
 	return DP_SUCCESS;
 ERR:
-	DP_Aux_Transfer(index, DP_AUX_I2C_WRITE & ~DP_AUX_I2C_MOT, 0x50, NULL, 0);
+	DP_Aux_Transfer(index, DP_AUX_I2C_WRITE & ~DP_AUX_I2C_MOT, DP_DDC_ADDR, NULL, 0);
 	return DP_FAILURE;
 }
 
@@ -1420,6 +1543,7 @@ int DP_Read_EDID(dp_index index, unsigned char *pEDIDBuffer, unsigned short *pBu
 				singleByte = true;
 			if (DP_Read_EDID_IIC_Aux(index, pEDIDBuffer, pBufferSize, singleByte) == DP_SUCCESS)
 			{
+				g_dp_info[index].edid_sum = pEDIDBuffer[DP_EDID_BUF_LEN - 1];
 				return 0;
 			}
 			pEDIDBuffer = pTmpaddr;
@@ -1502,6 +1626,11 @@ __attribute__((unused)) static void dp1ISR(
 	}
 }
 
+unsigned long DP_Aux_Get_Count(dp_index index)
+{
+	return g_dp_aux_count[index];
+}
+
 void DP_Hpd_Interrupt_Enable(dp_index index, unsigned int enable)
 {
 	unsigned int DPBaseAddr, value;
@@ -1603,7 +1732,8 @@ static int ddk770_dp_i2c_xfer(struct i2c_adapter *adap, struct i2c_msg msgs[], i
 			connector->i2c_is_regaddr = true;
 		}
 
-		if (connector->i2c_is_regaddr == true) {
+		/* A stop here would reset the E-DDC segment pointer */
+		if (connector->i2c_is_regaddr == true && addr != DP_DDC_SEGMENT_ADDR) {
 			DP_Aux_Transfer(index,
 					DP_AUX_I2C_WRITE & ~DP_AUX_I2C_MOT,
 					0x50, NULL, 0);
@@ -1615,7 +1745,7 @@ static int ddk770_dp_i2c_xfer(struct i2c_adapter *adap, struct i2c_msg msgs[], i
 		msg.buffer = NULL;
 		msg.size = 0;
 
-		transfer_size = 16;
+		transfer_size = DP_AUX_MAX_PAYLOAD_BYTES;
 		for (j = 0; j < msgs[i].len; j += msg.size) {
 
 			msg.buffer = msgs[i].buf + j;
@@ -1639,9 +1769,15 @@ static int ddk770_dp_i2c_xfer(struct i2c_adapter *adap, struct i2c_msg msgs[], i
 			}
 			transfer_size = ret;
 		}
-		DP_Aux_Transfer(index, DP_AUX_I2C_WRITE & ~DP_AUX_I2C_MOT, 0x50, NULL,0);
 	}
 
+	/*
+	 * Keep MOT set across the messages (segment, offset, data) and send
+	 * a single bare address stop once the whole transfer is done.
+	 */
+	if (num > 0)
+		DP_Aux_Transfer(index, DP_AUX_I2C_WRITE & ~DP_AUX_I2C_MOT, msgs[num - 1].addr, NULL, 0);
+
 
 	ret = num;
 	mutex_unlock(&connector->i2c_lock);
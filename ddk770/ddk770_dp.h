@@ -21,6 +21,9 @@
 #define DP_IIC_LMK03318_ADDR		0x50
 
 #define DP_EDID_BUF_LEN             128     /** Per Block size, */
+#define DP_EDID_MAX_BLOCKS          4
+#define DP_DDC_SEGMENT_ADDR         0x30
+#define DP_DDC_ADDR                 0x50
 
 #define DP_IDT_8T49N24X_FIN_MIN     8000
 #define DP_IDT_8T49N24X_FIN_MAX     875000000
@@ -207,6 +210,8 @@
 
 #define DP_LANE0_1_STATUS	0x202
 #define DP_LANE2_3_STATUS	0x203
+/* lane status, align status, sink status, adjust requests and post-cursor2 */
+#define DP_LINK_STATUS_ADJUST_SIZE	11
 #define DP_LANE_CR_DONE		    (1 << 0)
 #define DP_LANE_CHANNEL_EQ_DONE	    (1 << 1)
 #define DP_LANE_SYMBOL_LOCKED		    (1 << 2)
@@ -370,9 +375,29 @@ typedef struct {
 
     unsigned char dpcd[DP_RECEIVER_CAP_SIZE];
 	unsigned char sink_power_status;
+	/* checksum byte of the last EDID block 0 read from the sink */
+	unsigned char edid_sum;
     cea_parameter_t* cea_mode;
 } dp_info;
 
+/*
+ * Last successful link training result of a port. The entry is keyed by
+ * the receiver caps and the EDID checksum so a different sink on the same
+ * port never gets a stale lane count, rate or drive level.
+ */
+typedef struct {
+	unsigned char valid;
+	unsigned char dpcd[DP_RECEIVER_CAP_SIZE];
+	unsigned char edid_sum;
+	unsigned char lane_rate;
+	unsigned char lane_count;
+	unsigned char phy_rate;
+	unsigned char phy_lanes;
+	unsigned char swing[4];
+	unsigned char preem[4];
+	unsigned char pcursor[4];
+} dp_train_cache;
+
 struct drm_dp_aux_msg {
 	unsigned int address;
 	u8 request;
@@ -402,6 +427,7 @@ long unhookDPInterrupt(
 void DP_Hpd_Interrupt_Enable(dp_index index, unsigned int enable);
 
 int DP_Read_EDID(dp_index index, unsigned char *pEDIDBuffer, unsigned short *pBufferSize);
+unsigned long DP_Aux_Get_Count(dp_index index);
 int DP_HPD_Detect(dp_index index);
 
 
@@ -17,6 +17,15 @@
 int g_if_scrambling_lowR_HDMI[3] = { 0, 0, 0};
 int g_scdc_present[3] = { 1, 1, 1};
 
+/*
+ * TMDS clock of the last mode set on each port, 0 once it is in standby,
+ * the I2S sample rate and the audio mute of each port. All under
+ * hdmi_mode_mutex.
+ */
+static u32 g_hdmi_tmds_clk[3] = { 0, 0, 0};
+static u32 g_hdmi_audio_rate = SAMPLE_RATE;
+static bool g_hdmi_audio_muted[3] = { false, false, false };
+
 
 static DEFINE_MUTEX(hdmi_mode_mutex);
 /**
@@ -795,6 +804,10 @@ static void mc_enable_all_clocks(hdmi_index index)
 
 int ddk770_HDMI_Standby(hdmi_index index)
 {
+	mutex_lock(&hdmi_mode_mutex);
+	g_hdmi_tmds_clk[index] = 0;
+	mutex_unlock(&hdmi_mode_mutex);
+
 	mc_disable_all_clocks(index);
 	phy_standby(index);
 
@@ -900,7 +913,10 @@ long ddk770_HDMI_Set_Mode(hdmi_index index, logicalMode_t *pLogicalMode, mode_pa
 
 	//Audio and HDCP
 
-	ddk770_HDMI_TX_Common_Init(index,cea_mode.tmds_clk, SAMPLE_RATE);
+	g_hdmi_tmds_clk[index] = cea_mode.tmds_clk;
+	ddk770_HDMI_TX_Common_Init(index,cea_mode.tmds_clk, g_hdmi_audio_rate);
+	if (g_hdmi_audio_muted[index])
+		fc_audio_mute(index);
 
 	//Enable All clocks
 
@@ -941,13 +957,38 @@ void ddk770_HDMI_Disable_Output(hdmi_index index)
 
 void ddk770_HDMI_Audio_Mute(hdmi_index index)
 {
+	mutex_lock(&hdmi_mode_mutex);
+	g_hdmi_audio_muted[index] = true;
 	fc_audio_mute(index);
+	mutex_unlock(&hdmi_mode_mutex);
 }
 
 
 void ddk770_HDMI_Audio_Unmute(hdmi_index index)
 {
+	mutex_lock(&hdmi_mode_mutex);
+	g_hdmi_audio_muted[index] = false;
 	fc_audio_unmute(index);
+	mutex_unlock(&hdmi_mode_mutex);
+}
+
+/*
+ * Follow an I2S sample rate change. N and the channel status are
+ * recomputed for ports that are running a mode, the others pick the
+ * rate up at their next mode set. audio_Configure() unmutes, so the
+ * port's own mute is put back after it.
+ */
+void ddk770_HDMI_Audio_Set_Rate(hdmi_index index, u32 freq)
+{
+	mutex_lock(&hdmi_mode_mutex);
+	g_hdmi_audio_rate = freq;
+
+	if (g_hdmi_tmds_clk[index]) {
+		audio_Configure(index, g_hdmi_tmds_clk[index], freq);
+		if (g_hdmi_audio_muted[index])
+			fc_audio_mute(index);
+	}
+	mutex_unlock(&hdmi_mode_mutex);
 }
 
 
@@ -1113,13 +1154,41 @@ __attribute__((unused)) static void hdmi2ISR(
 }
 
 
-int hdmiISR(
+/*
+ * Decode and clear the interrupt of an HDMI port already known to be
+ * pending. Returns HDMI_INT_HPD on hot plug, HDMI_INT_NOT_HPD otherwise.
+ */
+int hdmiHandleISR(
     hdmi_index index)
 {
-	int intStatus;
     u32 decode = 0;
     u32 phy_decode = 0;
-	int ret = 0;
+	int ret = HDMI_INT_NOT_HPD;
+
+	decode = read_interrupt_decode(index);
+
+	if (decode_is_phy(decode))
+	{
+		phy_decode = ddk770_HDMI_Read_Register(index, IH_PHY_STAT0);
+
+		if (decode_is_phy_hpd(phy_decode))
+		{
+			// What we need to do in ISR
+			printk("We are in hdmi%d hpd ISR\n",index);
+			ret = HDMI_INT_HPD;
+			phy_hot_plug_detected(index);
+		}
+	}
+	/* Clear all the HDMI Interrupt */
+	ddk770_HDMI_Clear_Intr_State(index);
+
+	return ret;
+}
+
+int hdmiISR(
+    hdmi_index index)
+{
+	int intStatus;
 	int bit_value = 0;
 	intStatus = peekRegisterDWord(INT_STATUS);
 	if(index == (hdmi_index)HDMI0)
@@ -1129,29 +1198,9 @@ int hdmiISR(
 	else if(index == (hdmi_index)HDMI2)
 		bit_value = (intStatus >>15)&1;
 	if (bit_value == INT_STATUS_HDMI0_ACTIVE)
-	{
-	    decode = read_interrupt_decode(index);
-		
-	    if (decode_is_phy(decode))
-	    {
-	      phy_decode = ddk770_HDMI_Read_Register(index, IH_PHY_STAT0);
-	   
-		  if (decode_is_phy_hpd(phy_decode)) 
-		  {
-		        // What we need to do in ISR
-		        printk("We are in hdmi%d hpd ISR\n",index);
-		      	ret = HDMI_INT_HPD;
-		       	phy_hot_plug_detected(index);
-			
-		  }else
-		  	ret = HDMI_INT_NOT_HPD;
-	    }else
-			ret = HDMI_INT_NOT_HPD;
-			/* Clear all the HDMI Interrupt */ 
-		ddk770_HDMI_Clear_Intr_State(index); 
-	}
-	return ret;
+		return hdmiHandleISR(index);
 
+	return 0;
 }
 
 
@@ -73,6 +73,7 @@ void irq_mask_all(hdmi_index index);
 
 void ddk770_HDMI_Audio_Unmute(hdmi_index index);
 void ddk770_HDMI_Audio_Mute(hdmi_index index);
+void ddk770_HDMI_Audio_Set_Rate(hdmi_index index, u32 freq);
 
 /*
  * This is the main interrupt hook for HDMI engine.
@@ -104,6 +105,7 @@ void ddk770_HDMI_interrupt_enable(hdmi_index index, unsigned int enable);
 
 int ddk770_HDMI_Standby(hdmi_index index);
 int hdmiISR(hdmi_index index);
+int hdmiHandleISR(hdmi_index index);
 long ddk770_HDMI_AdaptHWI2CInit(struct smi_connector *connector);
 
 
@@ -12,6 +12,44 @@
 #include "ddk770_hdmi_audio.h"
 
 
+audio_n_computation_t n_values_32[] = {
+	{0,      4096},
+	{25175, 4576},
+	{25200, 4096},
+	{27000, 4096},
+	{27027, 4096},
+	{54000, 4096},
+	{54054, 4096},
+	{74176,11648},
+	{74250, 4096},
+	{148352,11648},
+	{148500, 4096},
+	{296703,5824},
+	{297000, 3072},
+	{593410, 5824},
+	{594000, 3072},
+	{0, 0}
+};
+
+audio_n_computation_t n_values_44p1[] = {
+	{0,      6272},
+	{25175, 7007},
+	{25200, 6272},
+	{27000, 6272},
+	{27027, 6272},
+	{54000, 6272},
+	{54054, 6272},
+	{74176,17836},
+	{74250, 6272},
+	{148352,8918},
+	{148500, 6272},
+	{296703,4459},
+	{297000, 4704},
+	{593410, 8918},
+	{594000, 9408},
+	{0, 0}
+};
+
 audio_n_computation_t n_values_48[] = {
 	{0,      6144},
 	{25175, 6864},
@@ -33,6 +71,10 @@ audio_n_computation_t n_values_48[] = {
 
 
 
+/*
+ * freq is the sample rate in Hz. 88.2/96 and 176.4/192 kHz use the
+ * 44.1/48 kHz N scaled by 2 and 4 (HDMI 1.4 section 7.2.1).
+ */
 static u32 audio_ComputeN(u32 freq, u32 pixelClk)
 {
 	int i = 0;
@@ -40,17 +82,23 @@ static u32 audio_ComputeN(u32 freq, u32 pixelClk)
 	audio_n_computation_t *n_values = NULL;
 	int multiplier_factor = 1;
 
-	if(u32_is_equal(freq, 64) || u32_is_equal(freq, 88) || u32_is_equal(freq, 96)){
+	if (freq == 64000 || freq == 88200 || freq == 96000) {
 		multiplier_factor = 2;
 	}
-	else if(u32_is_equal(freq, 128) || u32_is_equal(freq, 176) || u32_is_equal(freq, 192)){
+	else if (freq == 128000 || freq == 176400 || freq == 192000) {
 		multiplier_factor = 4;
 	}
-	else if(u32_is_equal(freq, 256) || u32_is_equal(freq, 352) || u32_is_equal(freq, 384)){
-		multiplier_factor = 8;
-	}
-	if(u32_is_equal(48, freq/multiplier_factor)){
+
+	switch (freq / multiplier_factor) {
+	case 32000:
+		n_values = n_values_32;
+		break;
+	case 44100:
+		n_values = n_values_44p1;
+		break;
+	default:
 		n_values = n_values_48;
+		break;
 	}
 
 	for(i = 0; n_values[i].n != 0; i++){
@@ -128,38 +176,32 @@ static void fc_audio_info_config(hdmi_index index, u32 freq)
     u32 sampling_freq = freq;
 
     /* Audio InfoFrame sample frequency when OBA or DST */
-    if (u32_is_equal(sampling_freq, 32))
+    switch (sampling_freq)
     {
+    case 32000:
         fc_sample_freq(index, 1);
-    }
-    else if (u32_is_equal(sampling_freq, 42))
-    {
+        break;
+    case 44100:
         fc_sample_freq(index, 2);
-    }
-    else if (u32_is_equal(sampling_freq, 48))
-    {
+        break;
+    case 48000:
         fc_sample_freq(index, 3);
-		printk("sample freq is 48\n");
-    }
-    else if (u32_is_equal(sampling_freq, 88))
-    {
+        break;
+    case 88200:
         fc_sample_freq(index, 4);
-    }
-    else if (u32_is_equal(sampling_freq, 96))
-    {
+        break;
+    case 96000:
         fc_sample_freq(index, 5);
-    }
-    else if (u32_is_equal(sampling_freq, 176))
-    {
+        break;
+    case 176400:
         fc_sample_freq(index, 6);
-    }
-    else if (u32_is_equal(sampling_freq, 192))
-    {
+        break;
+    case 192000:
         fc_sample_freq(index, 7);
-    }
-    else
-    {
+        break;
+    default:
         fc_sample_freq(index, 0);
+        break;
     }
 
     fc_coding_type(index, 0);   /* for HDMI refer to stream header  (0) */
@@ -285,9 +327,48 @@ static void _audio_clock_f(hdmi_index index, u8 value)
 }
 
 
-static void fc_audio_config(hdmi_index index)
+/*
+ * IEC 60958-3 channel status sampling frequency and original sampling
+ * frequency codes.
+ */
+static void fc_iec_freq_codes(u32 freq, u8 *sf, u8 *orig_sf)
+{
+	switch (freq) {
+	case 32000:
+		*sf = 0x3;
+		*orig_sf = 0xC;
+		break;
+	case 44100:
+		*sf = 0x0;
+		*orig_sf = 0xF;
+		break;
+	case 88200:
+		*sf = 0x8;
+		*orig_sf = 0x7;
+		break;
+	case 96000:
+		*sf = 0xA;
+		*orig_sf = 0x5;
+		break;
+	case 176400:
+		*sf = 0xC;
+		*orig_sf = 0x3;
+		break;
+	case 192000:
+		*sf = 0xE;
+		*orig_sf = 0x1;
+		break;
+	default:
+		*sf = 0x2;
+		*orig_sf = 0xD;
+		break;
+	}
+}
+
+static void fc_audio_config(hdmi_index index, u32 freq)
 {
 	int i = 0;
+	u8 sf, orig_sf;
 	
 	fc_packet_layout(index, 0); /// More than 2 channels => layout 1 else layout 0
 
@@ -298,9 +379,11 @@ static void fc_audio_config(hdmi_index index)
 
 	fc_iec_clock_accuracy(index, 0);
 
-	fc_iec_sampling_freq(index, 0x2);
+	fc_iec_freq_codes(freq, &sf, &orig_sf);
+
+	fc_iec_sampling_freq(index, sf);
 
-	fc_iec_original_sampling_freq(index, 0xD);
+	fc_iec_original_sampling_freq(index, orig_sf);
 
 	fc_iec_word_length(index, 0xB);    //word width
 }
@@ -330,7 +413,7 @@ void audio_Configure(hdmi_index index, u32 pixel_clock, u32 samplefreq)
 	fc_audio_mute(index);
 
 	// Configure Frame Composer audio parameters
-	fc_audio_config(index);
+	fc_audio_config(index, samplefreq);
 
 	audio_i2s_configure(index, SAMPLE_SIZE );	
 	//if set HDMI_AUD_INPUTCLKFS_128FS,TV does not have sound.
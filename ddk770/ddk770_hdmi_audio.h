@@ -3,7 +3,7 @@
 
 #include "ddk770_mode.h"
 
-#define SAMPLE_RATE 48
+#define SAMPLE_RATE 48000
 #define SAMPLE_SIZE 24
 #define WORD_LENGTH 24
 
@@ -13,6 +13,7 @@ typedef struct audio_n_computation {
 }audio_n_computation_t;
 
 int audio_Initialize(hdmi_index index);
+/* samplefreq in Hz */
 void audio_Configure(hdmi_index index, u32 pixel_clock, u32 samplefreq);
 void audio_i2s_configure(hdmi_index index, int sampleSize);
 
@@ -6,28 +6,28 @@
 
 
 
+#ifndef USE_INTERNAL_REGISTER_ACCESS
+
 #define PEEK32(addr) readl((addr)+mmio770)
 #define POKE32(addr,data) writel((data),(addr)+mmio770)
 
-#if 0
-unsigned int peekRegisterDWord(unsigned int offset);
-void pokeRegisterDWord(unsigned int offset, unsigned int value);
-
-
-unsigned char peekRegisterByte(unsigned int offset);
-
-void pokeRegisterByte(unsigned int offset, unsigned char value);
-
+#define peekRegisterDWord(addr) readl((addr)+mmio770)
+#define pokeRegisterDWord(addr,data) writel((data),(addr)+mmio770)
 
+#define peekRegisterByte(addr) readb((addr)+mmio770)
+#define pokeRegisterByte(addr,data) writeb((data),(addr)+mmio770)
 
 #else
+#include "../smi_regs.h"
 
+#define PEEK32(addr) SMI_REG_READ32(mmio770, (addr))
+#define POKE32(addr,data) SMI_REG_WRITE32(mmio770, (addr), (data))
 
-#define peekRegisterDWord(addr) readl((addr)+mmio770)
-#define pokeRegisterDWord(addr,data) writel((data),(addr)+mmio770)
+#define peekRegisterDWord(addr) SMI_REG_READ32(mmio770, (addr))
+#define pokeRegisterDWord(addr,data) SMI_REG_WRITE32(mmio770, (addr), (data))
 
-#define peekRegisterByte(addr) readb((addr)+mmio770)
-#define pokeRegisterByte(addr,data) writeb((data),(addr)+mmio770)
+#define peekRegisterByte(addr) SMI_REG_READ8(mmio770, (addr))
+#define pokeRegisterByte(addr,data) SMI_REG_WRITE8(mmio770, (addr), (data))
 
 #endif
 
@@ -86,7 +86,7 @@ void ddk770_iisOpen(
             ws = 0;
     }
 
-	clockDivider = (24576000)/(4*sampleRate*wordLength) - 1;
+	clockDivider = IIS_AUDIO_CLOCK/(4*sampleRate*wordLength) - 1;
 
     pokeRegisterDWord(I2S_CTRL, 
           FIELD_VALUE(0, I2S_CTRL, CS, ws)
@@ -95,6 +95,19 @@ void ddk770_iisOpen(
     pokeRegisterDWord(I2S_SRAM_DMA, 0);  //Default no DMA. Call another function to set up DMA
 }
 
+/*
+ * Whether the I2S clock divider can produce this sample rate exactly.
+ */
+int ddk770_iisRateValid(unsigned long wordLength, unsigned long sampleRate)
+{
+    unsigned long div = 4 * sampleRate * wordLength;
+
+    if (div == 0 || IIS_AUDIO_CLOCK % div)
+        return 0;
+
+    return FIELD_VAL_GET(0xffffffff, I2S_CTRL, CDIV) >= IIS_AUDIO_CLOCK / div - 1;
+}
+
 /*
  *    Turn off I2S and close GPIO 
  */
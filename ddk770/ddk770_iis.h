@@ -4,6 +4,7 @@
 #define MHz(x) (x*1000000) /* Don't use this macro if x is fraction number */
 
 #define IIS_REF_CLOCK MHz(40)
+#define IIS_AUDIO_CLOCK 24576000 /* I2S bit clock source */
 
 
 void ddk770_iis_Init(void);
@@ -16,6 +17,14 @@ void ddk770_iisOpen(
    unsigned long sampleRate  //Sampling rate.
 );
 
+/*
+ * Whether the I2S clock divider can produce this sample rate exactly.
+ */
+int ddk770_iisRateValid(
+   unsigned long wordLength, //Number of bits in IIS data: 16 bit, 24 bit, 32 bit
+   unsigned long sampleRate  //Sampling rate.
+);
+
 /*
  *    Turn off I2S and close GPIO 
  */
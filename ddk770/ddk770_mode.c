@@ -613,6 +613,22 @@ mode_parameter_t ddk770_getCurrentModeParam(
         return gChannel2CurrentModeParam;
 }
 
+/* 
+ * This function records the mode a channel is running without programming it.
+ */
+void ddk770_setCurrentModeParam(
+    disp_control_t dispCtrl,
+    mode_parameter_t *pModeParam
+)
+{
+    if (dispCtrl == CHANNEL0_CTRL)
+        gChannel0CurrentModeParam = *pModeParam;
+    else if (dispCtrl == CHANNEL1_CTRL)
+        gChannel1CurrentModeParam = *pModeParam;
+    else
+        gChannel2CurrentModeParam = *pModeParam;
+}
+
 /*
  *  ddk770_addTiming
  *      This function adds the SM750 mode parameter timing to the specified mode table
@@ -296,6 +296,15 @@ mode_parameter_t ddk770_getCurrentModeParam(
     disp_control_t dispCtrl
 );
 
+/* 
+ * This function records the mode a channel is running without programming it,
+ * e.g. a timing inherited from the VBIOS.
+ */
+void ddk770_setCurrentModeParam(
+    disp_control_t dispCtrl,
+    mode_parameter_t *pModeParam
+);
+
 /*
  *  ddk770_addTiming
  *      This function adds the SM750 mode parameter timing to the specified mode table
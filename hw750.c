@@ -7,6 +7,7 @@
 #include "ddk750/ddk750_defs.h"
 #include "ddk750/ddk750_display.h"
 #include "ddk750/ddk750_2d.h"
+#include "ddk750/ddk750_sw2d.h"
 #include "ddk750/ddk750_power.h"
 #include "ddk750/ddk750_edid.h"
 #include "ddk750/ddk750_cursor.h"
@@ -184,11 +185,15 @@ void hw750_resume(struct smi_750_register * pSave)
 
 }
 
-void hw750_set_base(int display,int pitch,int base_addr)
+/* Returns 1 when the previous base had not been latched yet */
+int hw750_set_base(int display,int pitch,int base_addr)
 {	
+	int pending;
 
 	if(display == 0)
 	{
+		pending = FIELD_VAL_GET(peekRegisterDWord(PRIMARY_FB_ADDRESS), PRIMARY_FB_ADDRESS, STATUS) ==
+			  PRIMARY_FB_ADDRESS_STATUS_PENDING;
 		pokeRegisterDWord(PRIMARY_FB_WIDTH,
 		          FIELD_VALUE(0, PRIMARY_FB_WIDTH, WIDTH, pitch)
 		        | FIELD_VALUE(0, PRIMARY_FB_WIDTH, OFFSET, pitch));
@@ -196,11 +201,24 @@ void hw750_set_base(int display,int pitch,int base_addr)
 	}
 	else
 	{
+		pending = FIELD_VAL_GET(peekRegisterDWord(SECONDARY_FB_ADDRESS), SECONDARY_FB_ADDRESS, STATUS) ==
+			  SECONDARY_FB_ADDRESS_STATUS_PENDING;
 		pokeRegisterDWord(SECONDARY_FB_WIDTH,
 		          FIELD_VALUE(0, SECONDARY_FB_WIDTH, WIDTH, pitch)
 		        | FIELD_VALUE(0, SECONDARY_FB_WIDTH, OFFSET, pitch));
 		setDisplayBaseAddress(CHANNEL1_CTRL, base_addr);
 	}
+
+	return pending;
+}
+
+/* Line the display controller is scanning out, for vblank timestamps */
+int hw750_get_current_line(int display)
+{
+	if (display == 0)
+		return FIELD_VAL_GET(peekRegisterDWord(PRIMARY_CURRENT_LINE), PRIMARY_CURRENT_LINE, LINE);
+	else
+		return FIELD_VAL_GET(peekRegisterDWord(SECONDARY_CURRENT_LINE), SECONDARY_CURRENT_LINE, LINE);
 }
 
 void hw750_set_dpms(int display,int state)
@@ -255,51 +273,69 @@ int hw750_en_dis_interrupt(int status)
 #endif
 
 
-int hw750_check_vsync_interrupt(int path)
+/*
+ * Copy size bytes of VRAM at offset into system memory at 32-bit bus
+ * address dst.
+ * The range is treated as 32bpp lines of HW750_READBACK_PITCH bytes and
+ * written by the 2D engine through the PCI master window.
+ */
+int hw750_vram_readback(unsigned long dst, unsigned long offset, unsigned long size)
 {
+	unsigned long dBase;
+	long ret;
 
-	unsigned long value1,value2;
-	
-	value1 = peekRegisterDWord(RAW_INT);
-	value2 = peekRegisterDWord(INT_MASK);
-	
-	if(path == CHANNEL0_CTRL)
-	{
-	    if ((FIELD_VAL_GET(value1, RAW_INT, PRIMARY_VSYNC) == RAW_INT_PRIMARY_VSYNC_ACTIVE)
-			&&(FIELD_VAL_GET(value2, INT_MASK, PRIMARY_VSYNC) == INT_MASK_PRIMARY_VSYNC_ENABLE))
-	    {
-			return true;
-		}
-	}else{
-		if ((FIELD_VAL_GET(value1, RAW_INT, SECONDARY_VSYNC) == RAW_INT_SECONDARY_VSYNC_ACTIVE)
-			&&(FIELD_VAL_GET(value2, INT_MASK, SECONDARY_VSYNC) == INT_MASK_SECONDARY_VSYNC_ENABLE))
-		{
-			return true;
-		}
+	if ((dst & 15) || (offset & 15) ||
+	    !size || (size % HW750_READBACK_PITCH))
+		return -1;
+
+	enableBusMaster(1);
+
+	dBase = setPCIMasterBaseAddress(dst);
+	if (dBase + size > (1 << 26)) {
+		enableBusMaster(0);
+		return -1;
 	}
-	return false;
-}
 
+	ret = deVideoMem2SystemMemBusMasterBlt(offset, HW750_READBACK_PITCH, 0, 0,
+					       dBase, HW750_READBACK_PITCH, 32, 0, 0,
+					       HW750_READBACK_PITCH / 4,
+					       size / HW750_READBACK_PITCH, ROP2_COPY);
+	if (!ret)
+		ret = deWaitForNotBusy();
+
+	enableBusMaster(0);
 
+	return ret ? -1 : 0;
+}
 
-void hw750_clear_vsync_interrupt(int path)
+/*
+ * Read the pending interrupt sources once and acknowledge them with a
+ * single RAW_INT write.
+ */
+unsigned int hw750_irq_ack(void)
 {
+	unsigned long status, raw = 0;
+	unsigned int pending = 0;
 
-	unsigned long value;
-		
-	value = peekRegisterDWord(RAW_INT);
-	
-	if(path == CHANNEL0_CTRL)
-	{
-	    
-		pokeRegisterDWord(RAW_INT, FIELD_SET(value, RAW_INT, PRIMARY_VSYNC, CLEAR));
+	status = peekRegisterDWord(INT_STATUS) & peekRegisterDWord(INT_MASK);
+	if (!status)
+		return 0;
 
-	}else{
-		
-		pokeRegisterDWord(RAW_INT, FIELD_SET(value, RAW_INT, SECONDARY_VSYNC, CLEAR));	
-		
+	if (FIELD_VAL_GET(status, INT_STATUS, PRIMARY_VSYNC) == INT_STATUS_PRIMARY_VSYNC_ACTIVE) {
+		pending |= SMI_IRQ_VSYNC(CHANNEL0_CTRL);
+		raw = FIELD_SET(raw, RAW_INT, PRIMARY_VSYNC, CLEAR);
 	}
+	if (FIELD_VAL_GET(status, INT_STATUS, SECONDARY_VSYNC) == INT_STATUS_SECONDARY_VSYNC_ACTIVE) {
+		pending |= SMI_IRQ_VSYNC(CHANNEL1_CTRL);
+		raw = FIELD_SET(raw, RAW_INT, SECONDARY_VSYNC, CLEAR);
+	}
+	if (FIELD_VAL_GET(status, INT_STATUS, DE) == INT_STATUS_DE_ACTIVE)
+		pending |= SMI_IRQ_DE;
+
+	if (raw)
+		pokeRegisterDWord(RAW_INT, raw);
 
+	return pending;
 }
 
 void ddk750_disable_IntMask(void)
@@ -115,7 +115,8 @@ void ddk750_enableCursor(
 
 
 
-void hw750_set_base(int display,int pitch,int base_addr);
+int hw750_set_base(int display,int pitch,int base_addr);
+int hw750_get_current_line(int display);
 
 long setMode(
 	logicalMode_t *pLogicalMode
@@ -136,8 +137,9 @@ void setDPMS(DPMS_t state);
 void hw750_set_dpms(int display,int state);
 void hw750_suspend(struct smi_750_register * pSave);
 void hw750_resume(struct smi_750_register * pSave);
-int hw750_check_vsync_interrupt(int path);
-void hw750_clear_vsync_interrupt(int path);
+#define HW750_READBACK_PITCH 4096
+int hw750_vram_readback(unsigned long dst, unsigned long offset, unsigned long size);
+unsigned int hw750_irq_ack(void);
 
 #if LINUX_VERSION_CODE < KERNEL_VERSION(5, 5, 0)
 int hw750_en_dis_interrupt(int status, int pipe);
@@ -5,6 +5,8 @@
 #include <drm/drm_modes.h>
 
 #include "ddk768/ddk768_mode.h"
+#include "ddk768/ddk768_chip.h"
+#include "ddk768/ddk768_clock.h"
 #include "ddk768/ddk768_help.h"
 #include "ddk768/ddk768_reg.h"	
 #include "ddk768/ddk768_display.h"
@@ -153,8 +155,40 @@ void hw768_resume(struct smi_768_register * pSave)
 		pokeRegisterDWord(0x8000 + HWC_CONTROL + i * 4, pSave->secondary_hwcurs_ctrl[i]);
 
 }
-void hw768_set_base(int display,int pitch,int base_addr)
+/*
+ * Gate the display controller clocks while the device is runtime
+ * suspended. Returns the DCs that were running so they can be brought
+ * back as they were.
+ */
+int hw768_gate_dc_clocks(void)
+{
+	unsigned long value = peekRegisterDWord(CLOCK_ENABLE);
+	int mask = 0;
+
+	if (FIELD_VAL_GET(value, CLOCK_ENABLE, DC0) == CLOCK_ENABLE_DC0_ON)
+		mask |= 1 << CHANNEL0_CTRL;
+	if (FIELD_VAL_GET(value, CLOCK_ENABLE, DC1) == CLOCK_ENABLE_DC1_ON)
+		mask |= 1 << CHANNEL1_CTRL;
+
+	ddk768_enableDC0(0);
+	ddk768_enableDC1(0);
+
+	return mask;
+}
+
+void hw768_ungate_dc_clocks(int mask)
+{
+	if (mask & (1 << CHANNEL0_CTRL))
+		ddk768_enableDC0(1);
+	if (mask & (1 << CHANNEL1_CTRL))
+		ddk768_enableDC1(1);
+}
+
+/* Returns 1 when the previous base had not been latched yet */
+int hw768_set_base(int display,int pitch,int base_addr)
 {	
+	int pending = FIELD_VAL_GET(peekRegisterDWord(FB_ADDRESS + (display ? CHANNEL_OFFSET : 0)),
+				    FB_ADDRESS, STATUS) == FB_ADDRESS_STATUS_PENDING;
 
 	if(display == 0)
 	{
@@ -189,6 +223,15 @@ void hw768_set_base(int display,int pitch,int base_addr)
 	    pokeRegisterDWord((FB_WIDTH+CHANNEL_OFFSET),FIELD_VALUE(peekRegisterDWord(FB_WIDTH+CHANNEL_OFFSET), FB_WIDTH, OFFSET, pitch));
 
 	}
+
+	return pending;
+}
+
+/* Line the display controller is scanning out, for vblank timestamps */
+int hw768_get_current_line(int display)
+{
+	return FIELD_VAL_GET(peekRegisterDWord(CURRENT_LINE + (display ? CHANNEL_OFFSET : 0)),
+			     CURRENT_LINE, LINE);
 }
 
 #ifdef USE_LT8618
@@ -269,63 +312,42 @@ int hw768_get_hdmi_edid(unsigned char *pEDIDBuffer)
     return ret;
 }
 
-int hw768_check_iis_interrupt(void)
+/*
+ * Read the pending interrupt sources once and acknowledge the display
+ * controller ones with a single RAW_INT write. The I2S source is cleared
+ * in the I2S block by the audio driver.
+ */
+unsigned int hw768_irq_ack(void)
 {
+	unsigned long status, raw = 0;
+	unsigned int pending = 0;
 
-	unsigned long value;
-		
-	value = peekRegisterDWord(INT_STATUS);
-
-	
-    if (FIELD_VAL_GET(value, INT_STATUS, I2S) == INT_STATUS_I2S_ACTIVE)
-		return true;
-	else	
-		return false;
-}
-
-
-int hw768_check_vsync_interrupt(int path)
-{
-
-	unsigned long value1,value2;
-		
-	value1 = peekRegisterDWord(RAW_INT);
-	value2 = peekRegisterDWord(INT_MASK);
+	status = peekRegisterDWord(INT_STATUS) & peekRegisterDWord(INT_MASK);
+	if (!status)
+		return 0;
 
-	if(path == CHANNEL0_CTRL)
-	{
-	    if ((FIELD_VAL_GET(value1, RAW_INT, CHANNEL0_VSYNC) == RAW_INT_CHANNEL0_VSYNC_ACTIVE)
-			&&(FIELD_VAL_GET(value2, INT_MASK, CHANNEL0_VSYNC) == INT_MASK_CHANNEL0_VSYNC_ENABLE))
-	    {
-			return true;
-		}
-	}else{
-		if ((FIELD_VAL_GET(value1, RAW_INT, CHANNEL1_VSYNC) == RAW_INT_CHANNEL1_VSYNC_ACTIVE)
-			&&(FIELD_VAL_GET(value2, INT_MASK, CHANNEL1_VSYNC) == INT_MASK_CHANNEL1_VSYNC_ENABLE))
-		{
-			return true;
-		}
+	if (FIELD_VAL_GET(status, INT_STATUS, CHANNEL0_VSYNC) == INT_STATUS_CHANNEL0_VSYNC_ACTIVE) {
+		pending |= SMI_IRQ_VSYNC(CHANNEL0_CTRL);
+		raw = FIELD_SET(raw, RAW_INT, CHANNEL0_VSYNC, CLEAR);
+	}
+	if (FIELD_VAL_GET(status, INT_STATUS, CHANNEL1_VSYNC) == INT_STATUS_CHANNEL1_VSYNC_ACTIVE) {
+		pending |= SMI_IRQ_VSYNC(CHANNEL1_CTRL);
+		raw = FIELD_SET(raw, RAW_INT, CHANNEL1_VSYNC, CLEAR);
+	}
+	if (FIELD_VAL_GET(status, INT_STATUS, DE) == INT_STATUS_DE_ACTIVE) {
+		pending |= SMI_IRQ_DE;
+		raw = FIELD_SET(raw, RAW_INT, DE, CLEAR);
 	}
-	
-	return false;
-}
 
+	if (FIELD_VAL_GET(status, INT_STATUS, I2S) == INT_STATUS_I2S_ACTIVE)
+		pending |= SMI_IRQ_I2S;
+	if (FIELD_VAL_GET(status, INT_STATUS, I2C0) == INT_STATUS_I2C0_ACTIVE)
+		pending |= SMI_IRQ_I2C;
 
-void hw768_clear_vsync_interrupt(int path)
-{
-	
-	unsigned long value;
-	
-	value = peekRegisterDWord(RAW_INT);
+	if (raw)
+		pokeRegisterDWord(RAW_INT, raw);
 
-	if (path == CHANNEL0_CTRL)
-	{
-		pokeRegisterDWord(RAW_INT, FIELD_SET(value, RAW_INT, CHANNEL0_VSYNC, CLEAR));
-	}
-	else
-	{
-		pokeRegisterDWord(RAW_INT, FIELD_SET(value, RAW_INT, CHANNEL1_VSYNC, CLEAR));
-	}
+	return pending;
 }
 
 long hw768_setMode(logicalMode_t *pLogicalMode, struct drm_display_mode mode)
@@ -342,6 +364,161 @@ long hw768_setMode(logicalMode_t *pLogicalMode, struct drm_display_mode mode)
 	
 }
 
+/*
+ * Read back the timing a channel is running. The pixel clock is not
+ * decoded from the PLL and is left at 0.
+ */
+static void hw768_read_mode_param(unsigned long offset, mode_parameter_t *pModeParam)
+{
+	unsigned long value;
+
+	memset(pModeParam, 0, sizeof(mode_parameter_t));
+
+	value = peekRegisterDWord(HORIZONTAL_TOTAL + offset);
+	pModeParam->horizontal_total = FIELD_VAL_GET(value, HORIZONTAL_TOTAL, TOTAL) + 1;
+	pModeParam->horizontal_display_end = FIELD_VAL_GET(value, HORIZONTAL_TOTAL, DISPLAY_END) + 1;
+
+	value = peekRegisterDWord(HORIZONTAL_SYNC + offset);
+	pModeParam->horizontal_sync_start = FIELD_VAL_GET(value, HORIZONTAL_SYNC, START) + 1;
+	pModeParam->horizontal_sync_width = FIELD_VAL_GET(value, HORIZONTAL_SYNC, WIDTH);
+
+	value = peekRegisterDWord(VERTICAL_TOTAL + offset);
+	pModeParam->vertical_total = FIELD_VAL_GET(value, VERTICAL_TOTAL, TOTAL) + 1;
+	pModeParam->vertical_display_end = FIELD_VAL_GET(value, VERTICAL_TOTAL, DISPLAY_END) + 1;
+
+	value = peekRegisterDWord(VERTICAL_SYNC + offset);
+	pModeParam->vertical_sync_start = FIELD_VAL_GET(value, VERTICAL_SYNC, START) + 1;
+	pModeParam->vertical_sync_height = FIELD_VAL_GET(value, VERTICAL_SYNC, HEIGHT);
+
+	value = peekRegisterDWord(DISPLAY_CTRL + offset);
+	pModeParam->horizontal_sync_polarity =
+		(FIELD_VAL_GET(value, DISPLAY_CTRL, HSYNC_PHASE) == DISPLAY_CTRL_HSYNC_PHASE_ACTIVE_HIGH) ? POS : NEG;
+	pModeParam->vertical_sync_polarity =
+		(FIELD_VAL_GET(value, DISPLAY_CTRL, VSYNC_PHASE) == DISPLAY_CTRL_VSYNC_PHASE_ACTIVE_HIGH) ? POS : NEG;
+}
+
+/*
+ * Check whether the channel is already scanning out what hw768_setMode()
+ * would program for this logical mode. The timing, format and pitch are
+ * compared against the live registers, so a channel reset by suspend
+ * never matches. A timing the driver did not set itself (left by the
+ * VBIOS) must also have a matching VCLK PLL, and is then recorded as the
+ * channel's current mode.
+ *
+ * Return: 1 if the mode is unchanged and live, 0 otherwise.
+ */
+int hw768_mode_unchanged(logicalMode_t *pLogicalMode, struct drm_display_mode mode)
+{
+	mode_parameter_t modeParam, currentParam, hwParam;
+	mode_parameter_t *pModeParam;
+	pll_value_t pll;
+	unsigned long offset, pllReg, value, format;
+
+	if (!pLogicalMode->valid_edid)
+	{
+		pModeParam = ddk768_findModeParam(pLogicalMode->dispCtrl, pLogicalMode->x,
+				pLogicalMode->y, pLogicalMode->hz, 0);
+		if (pModeParam == (mode_parameter_t *)0)
+			return 0;
+		modeParam = *pModeParam;
+	}
+	else
+		modeParam = convert_drm_mode_to_ddk_mode(mode);
+
+	value = peekRegisterDWord(VGA_CONFIGURATION);
+	if (FIELD_VAL_GET(value, VGA_CONFIGURATION, MODE) != VGA_CONFIGURATION_MODE_GRAPHIC)
+		return 0;
+
+	offset = (pLogicalMode->dispCtrl == CHANNEL0_CTRL) ? 0 : CHANNEL_OFFSET;
+	format = (pLogicalMode->bpp == 8) ? DISPLAY_CTRL_FORMAT_8 :
+		 (pLogicalMode->bpp == 16) ? DISPLAY_CTRL_FORMAT_16 : DISPLAY_CTRL_FORMAT_32;
+
+	value = peekRegisterDWord(DISPLAY_CTRL + offset);
+	if (FIELD_VAL_GET(value, DISPLAY_CTRL, TIMING) != DISPLAY_CTRL_TIMING_ENABLE ||
+	    FIELD_VAL_GET(value, DISPLAY_CTRL, FORMAT) != format)
+		return 0;
+
+	value = peekRegisterDWord(FB_WIDTH + offset);
+	if (FIELD_VAL_GET(value, FB_WIDTH, WIDTH) != PITCH(pLogicalMode->x, pLogicalMode->bpp))
+		return 0;
+
+	hw768_read_mode_param(offset, &hwParam);
+	hwParam.pixel_clock = modeParam.pixel_clock;
+	hwParam.horizontal_frequency = modeParam.horizontal_frequency;
+	hwParam.vertical_frequency = modeParam.vertical_frequency;
+	hwParam.clock_phase_polarity = modeParam.clock_phase_polarity;
+	if (compareModeParam(&modeParam, &hwParam) != 0)
+		return 0;
+
+	currentParam = ddk768_getCurrentModeParam(pLogicalMode->dispCtrl);
+	if (compareModeParam(&modeParam, &currentParam) == 0)
+		return 1;
+
+	if (ddk768_getCrystalType())
+		pll.inputFreq = (24576000 / 2);
+	else
+		pll.inputFreq = (24000000 / 2);
+	ddk768_calcPllValue(modeParam.pixel_clock, &pll);
+
+	pllReg = (pLogicalMode->dispCtrl == CHANNEL0_CTRL) ? VCLK0_PLL : VCLK1_PLL;
+	value = peekRegisterDWord(pllReg);
+	if (FIELD_VAL_GET(value, VCLK_PLL, POWER) != VCLK_PLL_POWER_NORMAL ||
+	    FIELD_VAL_GET(value, VCLK_PLL, BS) != pll.BS ||
+	    FIELD_VAL_GET(value, VCLK_PLL, VCO) != pll.VCO ||
+	    FIELD_VAL_GET(value, VCLK_PLL, INT) != pll.INT ||
+	    FIELD_VAL_GET(value, VCLK_PLL, FRAC) != pll.FRAC)
+		return 0;
+
+	ddk768_setCurrentModeParam(pLogicalMode->dispCtrl, &modeParam);
+
+	return 1;
+}
+
+/*
+ * Read back what a channel is scanning out: resolution, format, base
+ * address and pitch. Used to adopt the display left by the VBIOS.
+ *
+ * Return: 0 if the channel is scanning out, -1 otherwise.
+ */
+long hw768_get_current_mode(logicalMode_t *pLogicalMode)
+{
+	unsigned long offset, value;
+
+	value = peekRegisterDWord(VGA_CONFIGURATION);
+	if (FIELD_VAL_GET(value, VGA_CONFIGURATION, MODE) != VGA_CONFIGURATION_MODE_GRAPHIC)
+		return -1;
+
+	offset = (pLogicalMode->dispCtrl == CHANNEL0_CTRL) ? 0 : CHANNEL_OFFSET;
+
+	value = peekRegisterDWord(DISPLAY_CTRL + offset);
+	if (FIELD_VAL_GET(value, DISPLAY_CTRL, TIMING) != DISPLAY_CTRL_TIMING_ENABLE ||
+	    FIELD_VAL_GET(value, DISPLAY_CTRL, PLANE) != DISPLAY_CTRL_PLANE_ENABLE)
+		return -1;
+
+	switch (FIELD_VAL_GET(value, DISPLAY_CTRL, FORMAT))
+	{
+		case DISPLAY_CTRL_FORMAT_8:
+			pLogicalMode->bpp = 8;
+			break;
+		case DISPLAY_CTRL_FORMAT_16:
+			pLogicalMode->bpp = 16;
+			break;
+		default:
+			pLogicalMode->bpp = 32;
+			break;
+	}
+
+	value = peekRegisterDWord(HORIZONTAL_TOTAL + offset);
+	pLogicalMode->x = FIELD_VAL_GET(value, HORIZONTAL_TOTAL, DISPLAY_END) + 1;
+	value = peekRegisterDWord(VERTICAL_TOTAL + offset);
+	pLogicalMode->y = FIELD_VAL_GET(value, VERTICAL_TOTAL, DISPLAY_END) + 1;
+
+	pLogicalMode->baseAddress = FIELD_VAL_GET(peekRegisterDWord(FB_ADDRESS + offset), FB_ADDRESS, ADDRESS);
+	pLogicalMode->pitch = FIELD_VAL_GET(peekRegisterDWord(FB_WIDTH + offset), FB_WIDTH, OFFSET);
+
+	return 0;
+}
+
 
 int hdmi_int_status = 0;
 
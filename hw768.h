@@ -106,7 +106,8 @@ void ddk768_setCursorPosition(
                                        or within the screen left boundary (= 0) */
 );
  
-void hw768_set_base(int display,int pitch,int base_addr);
+int hw768_set_base(int display,int pitch,int base_addr);
+int hw768_get_current_line(int display);
  
 /*
  * This function enables/disables the cursor.
@@ -140,12 +141,11 @@ int hw768_set_hdmi_mode(logicalMode_t *pLogicalMode, struct drm_display_mode mod
 void ddk768_setDisplayEnable(disp_control_t dispControl, /* Channel 0 or Channel 1) */
 disp_state_t dispState /* ON or OFF */);
 
-int hw768_check_iis_interrupt(void);
-
-int hw768_check_vsync_interrupt(int path);
-void hw768_clear_vsync_interrupt(int path);
+unsigned int hw768_irq_ack(void);
 
 long hw768_setMode(logicalMode_t *pLogicalMode, struct drm_display_mode mode);
+int hw768_mode_unchanged(logicalMode_t *pLogicalMode, struct drm_display_mode mode);
+long hw768_get_current_mode(logicalMode_t *pLogicalMode);
 
 
 #if LINUX_VERSION_CODE < KERNEL_VERSION(5, 5, 0)
@@ -167,6 +167,8 @@ void ddk768_disable_IntMask(void);
 
 void hw768_suspend(struct smi_768_register * pSave);
 void hw768_resume(struct smi_768_register * pSave);
+int hw768_gate_dc_clocks(void);
+void hw768_ungate_dc_clocks(int mask);
 
 void hw768_setgamma(disp_control_t dispCtrl, unsigned long enable,unsigned long lvds_ch);
 void hw768_load_lut(disp_control_t dispCtrl, int size, u8 lut_r[], u8 lut_g[], u8 lut_b[]);
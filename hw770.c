@@ -12,6 +12,7 @@
 #include "ddk770/ddk770_video.h"
 #include "ddk770/ddk770_hdmi.h"
 #include "ddk770/ddk770_chip.h"
+#include "ddk770/ddk770_clock.h"
 #include "ddk770/ddk770_pwm.h"
 #include "ddk770/ddk770_swi2c.h"
 #include "ddk770/ddk770_hwi2c.h"
@@ -134,14 +135,51 @@ void hw770_resume(struct smi_770_register * pSave)
 	// 	pokeRegisterDWord(0x8000 + HWC_CONTROL + i * 4, pSave->secondary_hwcurs_ctrl[i]);
 
 }
-void hw770_set_base(disp_control_t dispControl,int pitch,int base_addr)
+/*
+ * Gate the display controller clocks while the device is runtime
+ * suspended. HDMI and DP stay clocked so hotplug keeps working.
+ * Returns the DCs that were running.
+ */
+int hw770_gate_dc_clocks(void)
+{
+	unsigned long value = peekRegisterDWord(CLOCK_ENABLE);
+	int mask = 0;
+
+	if (FIELD_VAL_GET(value, CLOCK_ENABLE, DC0) == CLOCK_ENABLE_DC0_ON)
+		mask |= 1 << CHANNEL0_CTRL;
+	if (FIELD_VAL_GET(value, CLOCK_ENABLE, DC1) == CLOCK_ENABLE_DC1_ON)
+		mask |= 1 << CHANNEL1_CTRL;
+	if (FIELD_VAL_GET(value, CLOCK_ENABLE, DC2) == CLOCK_ENABLE_DC2_ON)
+		mask |= 1 << CHANNEL2_CTRL;
+
+	ddk770_enableDC0(0);
+	ddk770_enableDC1(0);
+	ddk770_enableDC2(0);
+
+	return mask;
+}
+
+void hw770_ungate_dc_clocks(int mask)
+{
+	if (mask & (1 << CHANNEL0_CTRL))
+		ddk770_enableDC0(1);
+	if (mask & (1 << CHANNEL1_CTRL))
+		ddk770_enableDC1(1);
+	if (mask & (1 << CHANNEL2_CTRL))
+		ddk770_enableDC2(1);
+}
+
+/* Returns 1 when the previous base had not been latched yet */
+int hw770_set_base(disp_control_t dispControl,int pitch,int base_addr)
 {	
 
 	unsigned int ulFBBaseAddr, ulFBPitchAddr, ulFBPitchReg,LineOffset;
+	int pending;
 
 	LineOffset = alignLineOffset(pitch);
 
 	ulFBBaseAddr = FB_ADDRESS + (dispControl> 1? CHANNEL_OFFSET2 : dispControl * CHANNEL_OFFSET);
+	pending = FIELD_VAL_GET(peekRegisterDWord(ulFBBaseAddr), FB_ADDRESS, STATUS) == FB_ADDRESS_STATUS_PENDING;
 
 	/* Frame buffer base */
 	pokeRegisterDWord(ulFBBaseAddr,
@@ -158,8 +196,13 @@ void hw770_set_base(disp_control_t dispControl,int pitch,int base_addr)
 
 	pokeRegisterDWord(ulFBPitchAddr, FIELD_VALUE(ulFBPitchReg, FB_WIDTH, OFFSET, LineOffset));	
 
+	return pending;
+}
 
-
+/* Line the display controller is scanning out, for vblank timestamps */
+int hw770_get_current_line(disp_control_t dispControl)
+{
+	return ddk770_getDisplayLine(dispControl);
 }
 
 
@@ -337,72 +380,56 @@ void hw770_DP_Clear_Channel(dp_index index)
 	        DP_Clear_Channel(index);
 }
 
-int hw770_check_iis_interrupt(void)
+/*
+ * Read the pending interrupt sources once and acknowledge the display
+ * controller ones with a single RAW_INT write. The I2S and HDMI sources
+ * are cleared in their own blocks by the consumers.
+ */
+unsigned int hw770_irq_ack(void)
 {
+	unsigned long status, raw = 0;
+	unsigned int pending = 0;
 
-	 unsigned long value;
-		
-	value = peekRegisterDWord(INT_STATUS);
-
-	
-   if (FIELD_VAL_GET(value, INT_STATUS, I2S) == INT_STATUS_I2S_ACTIVE)
-	 return true;
-   else	
-	 return false;
-}
-
-int hw770_check_vsync_interrupt(int path)
-{
-
-	unsigned long value1,value2;
-		
-	value1 = peekRegisterDWord(RAW_INT);
-	value2 = peekRegisterDWord(INT_MASK);
-
-	if(path == CHANNEL0_CTRL)
-	{
-	   if ((FIELD_VAL_GET(value1, RAW_INT, CHANNEL0_VSYNC) == RAW_INT_CHANNEL0_VSYNC_ACTIVE)
-			&&(FIELD_VAL_GET(value2, INT_MASK, CHANNEL0_VSYNC) == INT_MASK_CHANNEL0_VSYNC_ENABLE))
-	    {
-		return true;
-		}
-	 }else if (path == CHANNEL1_CTRL){
-		if ((FIELD_VAL_GET(value1, RAW_INT, CHANNEL1_VSYNC) == RAW_INT_CHANNEL1_VSYNC_ACTIVE)
-			&&(FIELD_VAL_GET(value2, INT_MASK, CHANNEL1_VSYNC) == INT_MASK_CHANNEL1_VSYNC_ENABLE))
-	    {
-		return true;
-		}
-	}else{
-		if ((FIELD_VAL_GET(value1, RAW_INT, CHANNEL2_VSYNC) == RAW_INT_CHANNEL2_VSYNC_ACTIVE)
-			&&(FIELD_VAL_GET(value2, INT_MASK, CHANNEL2_VSYNC) == INT_MASK_CHANNEL2_VSYNC_ENABLE))
-		{
-		return true;
-		}
+	status = peekRegisterDWord(INT_STATUS) & peekRegisterDWord(INT_MASK);
+	if (!status)
+		return 0;
 
+	if (FIELD_VAL_GET(status, INT_STATUS, CHANNEL0_VSYNC) == INT_STATUS_CHANNEL0_VSYNC_ACTIVE) {
+		pending |= SMI_IRQ_VSYNC(CHANNEL0_CTRL);
+		raw = FIELD_SET(raw, RAW_INT, CHANNEL0_VSYNC, CLEAR);
 	}
-
-	return false;
-}
-
-void hw770_clear_vsync_interrupt(int path)
-{
-	
-	unsigned long value;
-	
-	value = peekRegisterDWord(RAW_INT);
-
-	if (path == CHANNEL0_CTRL)
-	{
-		pokeRegisterDWord(RAW_INT, FIELD_SET(value, RAW_INT, CHANNEL0_VSYNC, CLEAR));
+	if (FIELD_VAL_GET(status, INT_STATUS, CHANNEL1_VSYNC) == INT_STATUS_CHANNEL1_VSYNC_ACTIVE) {
+		pending |= SMI_IRQ_VSYNC(CHANNEL1_CTRL);
+		raw = FIELD_SET(raw, RAW_INT, CHANNEL1_VSYNC, CLEAR);
 	}
-	else if (path == CHANNEL1_CTRL)
-	{
-		pokeRegisterDWord(RAW_INT, FIELD_SET(value, RAW_INT, CHANNEL1_VSYNC, CLEAR));
+	if (FIELD_VAL_GET(status, INT_STATUS, CHANNEL2_VSYNC) == INT_STATUS_CHANNEL2_VSYNC_ACTIVE) {
+		pending |= SMI_IRQ_VSYNC(CHANNEL2_CTRL);
+		raw = FIELD_SET(raw, RAW_INT, CHANNEL2_VSYNC, CLEAR);
 	}
-	else
-	{
-		pokeRegisterDWord(RAW_INT, FIELD_SET(value, RAW_INT, CHANNEL2_VSYNC, CLEAR));
+	if (FIELD_VAL_GET(status, INT_STATUS, DE) == INT_STATUS_DE_ACTIVE) {
+		pending |= SMI_IRQ_DE;
+		raw = FIELD_SET(raw, RAW_INT, DE, CLEAR);
 	}
+
+	if (FIELD_VAL_GET(status, INT_STATUS, HDMI0) == INT_STATUS_HDMI0_ACTIVE)
+		pending |= SMI_IRQ_HDMI(INDEX_HDMI0);
+	if (FIELD_VAL_GET(status, INT_STATUS, HDMI1) == INT_STATUS_HDMI1_ACTIVE)
+		pending |= SMI_IRQ_HDMI(INDEX_HDMI1);
+	if (FIELD_VAL_GET(status, INT_STATUS, HDMI2) == INT_STATUS_HDMI2_ACTIVE)
+		pending |= SMI_IRQ_HDMI(INDEX_HDMI2);
+	if (FIELD_VAL_GET(status, INT_STATUS, DP0) == INT_STATUS_DP0_ACTIVE)
+		pending |= SMI_IRQ_DP(INDEX_DP0);
+	if (FIELD_VAL_GET(status, INT_STATUS, DP1) == INT_STATUS_DP1_ACTIVE)
+		pending |= SMI_IRQ_DP(INDEX_DP1);
+	if (FIELD_VAL_GET(status, INT_STATUS, I2S) == INT_STATUS_I2S_ACTIVE)
+		pending |= SMI_IRQ_I2S;
+	if (FIELD_VAL_GET(status, INT_STATUS, I2C0) == INT_STATUS_I2C0_ACTIVE)
+		pending |= SMI_IRQ_I2C;
+
+	if (raw)
+		pokeRegisterDWord(RAW_INT, raw);
+
+	return pending;
 }
 
 long hw770_setMode(logicalMode_t *pLogicalMode, struct drm_display_mode mode)
@@ -418,6 +445,114 @@ long hw770_setMode(logicalMode_t *pLogicalMode, struct drm_display_mode mode)
 	
 }
 
+/*
+ * Read back the timing a channel is running. The pixel clock is not
+ * decoded from the PLL and is left at 0.
+ */
+static void hw770_read_mode_param(unsigned long offset, mode_parameter_t *pModeParam)
+{
+	unsigned long value;
+
+	memset(pModeParam, 0, sizeof(mode_parameter_t));
+
+	value = peekRegisterDWord(HORIZONTAL_TOTAL + offset);
+	pModeParam->horizontal_total = FIELD_VAL_GET(value, HORIZONTAL_TOTAL, TOTAL) + 1;
+	pModeParam->horizontal_display_end = FIELD_VAL_GET(value, HORIZONTAL_TOTAL, DISPLAY_END) + 1;
+
+	value = peekRegisterDWord(HORIZONTAL_SYNC + offset);
+	pModeParam->horizontal_sync_start = FIELD_VAL_GET(value, HORIZONTAL_SYNC, START) + 1;
+	pModeParam->horizontal_sync_width = FIELD_VAL_GET(value, HORIZONTAL_SYNC, WIDTH);
+
+	value = peekRegisterDWord(VERTICAL_TOTAL + offset);
+	pModeParam->vertical_total = FIELD_VAL_GET(value, VERTICAL_TOTAL, TOTAL) + 1;
+	pModeParam->vertical_display_end = FIELD_VAL_GET(value, VERTICAL_TOTAL, DISPLAY_END) + 1;
+
+	value = peekRegisterDWord(VERTICAL_SYNC + offset);
+	pModeParam->vertical_sync_start = FIELD_VAL_GET(value, VERTICAL_SYNC, START) + 1;
+	pModeParam->vertical_sync_height = FIELD_VAL_GET(value, VERTICAL_SYNC, HEIGHT);
+
+	value = peekRegisterDWord(DISPLAY_CTRL + offset);
+	pModeParam->horizontal_sync_polarity =
+		(FIELD_VAL_GET(value, DISPLAY_CTRL, HSYNC_PHASE) == DISPLAY_CTRL_HSYNC_PHASE_ACTIVE_HIGH) ? POS : NEG;
+	pModeParam->vertical_sync_polarity =
+		(FIELD_VAL_GET(value, DISPLAY_CTRL, VSYNC_PHASE) == DISPLAY_CTRL_VSYNC_PHASE_ACTIVE_HIGH) ? POS : NEG;
+}
+
+/*
+ * Check whether the channel is already scanning out what hw770_setMode()
+ * would program for this logical mode. The timing, format and pitch are
+ * compared against the live registers, so a channel reset by suspend
+ * never matches. A timing the driver did not set itself must also have
+ * a matching VCLK PLL, and is then recorded as the channel's current mode.
+ *
+ * Return: 1 if the mode is unchanged and live, 0 otherwise.
+ */
+int hw770_mode_unchanged(logicalMode_t *pLogicalMode, struct drm_display_mode mode)
+{
+	mode_parameter_t modeParam, currentParam, hwParam;
+	mode_parameter_t *pModeParam;
+	pll_value_t pll;
+	unsigned long offset, pllReg, value, format;
+
+	if (!pLogicalMode->valid_edid)
+	{
+		pModeParam = ddk770_findModeParam(pLogicalMode->dispCtrl, pLogicalMode->x,
+				pLogicalMode->y, pLogicalMode->hz, 0);
+		if (pModeParam == (mode_parameter_t *)0)
+			return 0;
+		modeParam = *pModeParam;
+	}
+	else
+		modeParam = hw770_convert_drm_mode_to_ddk_mode(mode);
+
+	if (!ddk770_isTimingEnable(pLogicalMode->dispCtrl))
+		return 0;
+
+	offset = (pLogicalMode->dispCtrl > 1) ? CHANNEL_OFFSET2 : pLogicalMode->dispCtrl * CHANNEL_OFFSET;
+	format = (pLogicalMode->bpp == 8) ? DISPLAY_CTRL_FORMAT_8 :
+		 (pLogicalMode->bpp == 16) ? DISPLAY_CTRL_FORMAT_16 : DISPLAY_CTRL_FORMAT_32;
+
+	value = peekRegisterDWord(DISPLAY_CTRL + offset);
+	if (FIELD_VAL_GET(value, DISPLAY_CTRL, FORMAT) != format)
+		return 0;
+
+	value = peekRegisterDWord(FB_WIDTH + offset);
+	if (FIELD_VAL_GET(value, FB_WIDTH, WIDTH) != PITCH(pLogicalMode->x, pLogicalMode->bpp))
+		return 0;
+
+	hw770_read_mode_param(offset, &hwParam);
+	hwParam.pixel_clock = modeParam.pixel_clock;
+	hwParam.horizontal_frequency = modeParam.horizontal_frequency;
+	hwParam.vertical_frequency = modeParam.vertical_frequency;
+	hwParam.clock_phase_polarity = modeParam.clock_phase_polarity;
+	if (ddk770_compareModeParam(&modeParam, &hwParam) != 0)
+		return 0;
+
+	currentParam = ddk770_getCurrentModeParam(pLogicalMode->dispCtrl);
+	if (ddk770_compareModeParam(&modeParam, &currentParam) == 0)
+		return 1;
+
+	pll.inputFreq = 12500000;
+	ddk770_calcPllValue(modeParam.pixel_clock, &pll);
+
+	if (pLogicalMode->dispCtrl == CHANNEL0_CTRL)
+		pllReg = VCLK_PLL;
+	else if (pLogicalMode->dispCtrl == CHANNEL1_CTRL)
+		pllReg = VCLK1_PLL;
+	else
+		pllReg = VCLK2_PLL;
+
+	value = peekRegisterDWord(pllReg);
+	if (FIELD_VAL_GET(value, VCLK_PLL, PRESEL) != VCLK_PLL_PRESEL_125 ||
+	    FIELD_VAL_GET(value, VCLK_PLL, VCO) != pll.VCO ||
+	    FIELD_VAL_GET(value, VCLK_PLL, DIVIDER) != pll.DIV)
+		return 0;
+
+	ddk770_setCurrentModeParam(pLogicalMode->dispCtrl, &modeParam);
+
+	return 1;
+}
+
 int hw770_hdmi_detect(hdmi_index hdmi_index)
 {
 
@@ -525,29 +660,61 @@ long hw770_AdaptI2CCleanBus(struct drm_connector *connector)
     
 }
 
-void hw770_AudioInit(unsigned long wordLength, unsigned long sampleRate)
+void hw770_AudioInit(unsigned long wordLength, unsigned long sampleRate, unsigned long section)
 {
+	int i;
     
 	// Set up I2S and GPIO registers to transmit/receive data.
     ddk770_iisOpen(wordLength, sampleRate);
-	//Set I2S to DMA 256 DWord from SRAM starting at location 0 of SRAM
-	ddk770_iisTxDmaSetup(0,SRAM_SECTION_SIZE);
+	//Set I2S to DMA one section at a time from SRAM starting at location 0 of SRAM
+	ddk770_iisTxDmaSetup(0, section);
+
+	// HDMI N/CTS and channel status follow the I2S rate
+	for (i = 0; i < 3; i++)
+		ddk770_HDMI_Audio_Set_Rate(i, sampleRate);
 }
 
-void hw770_AudioStart(void)
+int hw770_AudioRateValid(unsigned long wordLength, unsigned long sampleRate)
 {
-	int i = 0;
-	
-	for (i = 0 ; i <3 ;i++) 
-	{
-    	ddk770_HDMI_Audio_Unmute(i);
-	}
+	return ddk770_iisRateValid(wordLength, sampleRate);
+}
 
-	for (i = 0 ; i <2 ;i++) 
-	{
-		DP_Audio_UnMute(i);
+/* Encoders fed from I2S: bit 0-2 HDMI0-2, bit 3-4 DP0-1 */
+static unsigned int hw770_audio_route = HW770_AUDIO_ROUTE_ALL;
+
+/*
+ * All encoders take the same I2S stream. Unmuting several of them clones
+ * it to each sink, in step and without any extra copy.
+ */
+void hw770_AudioRoute(unsigned int route)
+{
+	int i;
+
+	hw770_audio_route = route;
+
+	for (i = 0; i < 3; i++) {
+		if (route & (1 << i))
+			ddk770_HDMI_Audio_Unmute(i);
+		else
+			ddk770_HDMI_Audio_Mute(i);
+	}
 
+	for (i = 0; i < 2; i++) {
+		if (route & (1 << (3 + i)))
+			DP_Audio_UnMute(i);
+		else
+			DP_Audio_Mute(i);
 	}
+}
+
+unsigned int hw770_AudioGetRoute(void)
+{
+	return hw770_audio_route;
+}
+
+void hw770_AudioStart(void)
+{
+	hw770_AudioRoute(hw770_audio_route);
 
 	ddk770_iisStart();
 }
@@ -584,11 +751,10 @@ void hw770_AudioDeinit(void)
 }
 
 
-int hw770_check_pnp_interrupt(hdmi_index index)
+/* Service an HDMI interrupt flagged by hw770_irq_ack() */
+int hw770_hdmi_irq(hdmi_index index)
 {
-	int ret = 0;
-	ret = hdmiISR(index);
-	return ret;
+	return hdmiHandleISR(index);
 }
 
 void hw770_hdmi_interrupt_enable(hdmi_index index,int enable)
@@ -628,6 +794,11 @@ int hw770_dp_check_sink_status(dp_index index)
 	return ret;
 }
 
+unsigned long hw770_get_dp_aux_count(dp_index index)
+{
+	return DP_Aux_Get_Count(index);
+}
+
 int hw770_get_current_mode_width(disp_control_t index)
 {
 	int width;
@@ -90,7 +90,8 @@ void ddk770_setCursorPosition(
     unsigned int enable
 );
  
-void hw770_set_base(disp_control_t dispControl,int pitch,int base_addr);
+int hw770_set_base(disp_control_t dispControl,int pitch,int base_addr);
+int hw770_get_current_line(disp_control_t dispControl);
  
 /*
  * This function enables/disables the cursor.
@@ -123,12 +124,10 @@ void hw770_init_hdmi(void);
 int hw770_set_hdmi_mode(logicalMode_t *pLogicalMode, struct drm_display_mode mode, bool isHDMI, int hdmi_index);
 
 
-int hw770_check_iis_interrupt(void);
-
-int hw770_check_vsync_interrupt(int path);
-void hw770_clear_vsync_interrupt(int path);
+unsigned int hw770_irq_ack(void);
 
 long hw770_setMode(logicalMode_t *pLogicalMode, struct drm_display_mode mode);
+int hw770_mode_unchanged(logicalMode_t *pLogicalMode, struct drm_display_mode mode);
 
 
 #if LINUX_VERSION_CODE < KERNEL_VERSION(5, 5, 0)
@@ -145,6 +144,8 @@ void ddk770_disable_IntMask(void);
 
 void hw770_suspend(struct smi_770_register * pSave);
 void hw770_resume(struct smi_770_register * pSave);
+int hw770_gate_dc_clocks(void);
+void hw770_ungate_dc_clocks(int mask);
 
 void hw770_setgamma(disp_control_t dispCtrl, unsigned long enable);
 void hw770_load_lut(disp_control_t dispCtrl, int size, u8 lut_r[], u8 lut_g[], u8 lut_b[]);
@@ -154,7 +155,12 @@ long hw770_AdaptI2CCleanBus(
 );
 long hw770_AdaptI2CInit(struct smi_connector *smi_connector);
 
-void hw770_AudioInit(unsigned long wordLength, unsigned long sampleRate);
+void hw770_AudioInit(unsigned long wordLength, unsigned long sampleRate, unsigned long section);
+int hw770_AudioRateValid(unsigned long wordLength, unsigned long sampleRate);
+
+#define HW770_AUDIO_ROUTE_ALL 0x1f
+void hw770_AudioRoute(unsigned int route);
+unsigned int hw770_AudioGetRoute(void);
 void hw770_AudioStart(void);
 void hw770_AudioStop(void);
 void hw770_AudioDeinit(void);
@@ -175,13 +181,14 @@ void ddk770_WM8978_SPKvol_Set(unsigned char volx);
 unsigned short alignLineOffset(unsigned short lineOffset);
 
 int hw770_hdmi_detect(hdmi_index hdmi_index);
-int hw770_check_pnp_interrupt(hdmi_index index);
+int hw770_hdmi_irq(hdmi_index index);
 void hw770_hdmi_interrupt_enable(hdmi_index index,int enable);
 
 void  hw770_get_current_fb_info(disp_control_t index, struct smi_770_fb_info *fb_info);
 void hw770_set_current_pitch(disp_control_t index, struct smi_770_fb_info *fb_info);
 void hw770_i2c_reset_busclear(hdmi_index index);
 int hw770_dp_check_sink_status(dp_index index);
+unsigned long hw770_get_dp_aux_count(dp_index index);
 
 int hw770_get_current_mode_width(disp_control_t index);
 
@@ -77,6 +77,14 @@ typedef enum{
     INDEX_DP_PHY
 } dp_index;
 
+/* Pending interrupt sources, as returned by hw7xx_irq_ack() */
+#define SMI_IRQ_VSYNC(x)        (1 << (x))          /* DC0-DC2 vsync */
+#define SMI_IRQ_HDMI(x)         (1 << (3 + (x)))    /* SM770 HDMI0-2 */
+#define SMI_IRQ_I2S             (1 << 6)
+#define SMI_IRQ_DE              (1 << 7)            /* 2D engine idle */
+#define SMI_IRQ_I2C             (1 << 8)
+#define SMI_IRQ_DP(x)           (1 << (9 + (x)))    /* SM770 DP0-1 */
+
 
 typedef enum _spolarity_t
 {
@@ -8,7 +8,13 @@
 #include <linux/debugfs.h>
 #include <drm/drm_debugfs.h>
 #include <linux/uaccess.h>
+#include <linux/seq_file.h>
 #include "smi_debugfs.h"
+#include "smi_perf.h"
+#if defined(SMI_REG_TRACE) || defined(SMI_REG_CACHE)
+#include "smi_regs.h"
+#endif
+#include "hw770.h"
 
 
 extern int smi_debug;
@@ -88,6 +94,69 @@ static const struct file_operations reg_fops = {
 	.read  = reg_read,
 	.write = reg_write,
 };
+struct smi_capture {
+	size_t size;
+	u8 data[];
+};
+
+/* Snapshot the scan-out of display channel capture_ctrl when opened */
+static int capture_open(struct inode *inode, struct file *file)
+{
+	struct smi_device *sdev = inode->i_private;
+	u32 capture_ctrl = READ_ONCE(sdev->capture_ctrl);
+	struct smi_vram_region *region;
+	struct smi_capture *cap;
+
+	if (capture_ctrl >= MAX_CRTC_770)
+		return -EINVAL;
+
+	region = &sdev->vram_regions[capture_ctrl][SMI_VRAM_PRIMARY];
+	if (!region->size)
+		return -ENODATA;
+
+	cap = kvmalloc(sizeof(*cap) + region->size, GFP_KERNEL);
+	if (!cap)
+		return -ENOMEM;
+
+	cap->size = region->size;
+	if (smi_vram_read(sdev, cap->data, region->offset, region->size)) {
+		kvfree(cap);
+		return -EIO;
+	}
+
+	file->private_data = cap;
+	return 0;
+}
+
+static ssize_t capture_read(struct file *file, char __user *user_data, size_t cnt, loff_t *lt)
+{
+	struct smi_capture *cap = file->private_data;
+
+	return simple_read_from_buffer(user_data, cnt, lt, cap->data, cap->size);
+}
+
+static int capture_release(struct inode *inode, struct file *file)
+{
+	kvfree(file->private_data);
+	return 0;
+}
+
+static const struct file_operations capture_fops = {
+	.owner   = THIS_MODULE,
+	.open    = capture_open,
+	.read    = capture_read,
+	.release = capture_release,
+};
+
+static int dp_aux_count_show(struct seq_file *m, void *unused)
+{
+	seq_printf(m, "DP0: %lu\n", hw770_get_dp_aux_count(INDEX_DP0));
+	seq_printf(m, "DP1: %lu\n", hw770_get_dp_aux_count(INDEX_DP1));
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(dp_aux_count);
+
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 8, 0)
      void smi_debugfs_init(struct drm_minor *minor)
 #else
@@ -146,6 +215,20 @@ static const struct file_operations reg_fops = {
 	debugfs_create_file("regrw", 0644, minor->debugfs_root, minor->dev, &reg_fops);
 	}
 
+	debugfs_create_u32("capture_ctrl", S_IRUGO | S_IWUSR, minor->debugfs_root, &sdev->capture_ctrl);
+	debugfs_create_file("capture", 0400, minor->debugfs_root, sdev, &capture_fops);
+
+	if (sdev->specId == SPC_SM770)
+		debugfs_create_file("dp_aux_count", 0444, minor->debugfs_root, NULL, &dp_aux_count_fops);
+
+	smi_perf_debugfs_init(sdev, minor->debugfs_root);
+#ifdef SMI_REG_CACHE
+	smi_regcache_debugfs_init(sdev, minor->debugfs_root);
+#endif
+#ifdef SMI_REG_TRACE
+	smi_regtrace_debugfs_init(minor->debugfs_root);
+#endif
+
 
 DEBUGFS_FAIL:
 #if LINUX_VERSION_CODE < KERNEL_VERSION(5, 8, 0)
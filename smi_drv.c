@@ -5,6 +5,7 @@
 #include <linux/console.h>
 #include <linux/module.h>
 #include <linux/delay.h>
+#include <linux/pm_runtime.h>
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 11, 0)
 #include <drm/drm_fbdev_ttm.h>
@@ -48,6 +49,11 @@
 #include <drm/drm_crtc_helper.h>
 
 #include "smi_dbg.h"
+#include "smi_trace.h"
+#include "smi_perf.h"
+#ifdef SMI_REG_CACHE
+#include "smi_regs.h"
+#endif
 
 #include "hw750.h"
 #include "hw768.h"
@@ -72,8 +78,10 @@ int smi_debug = 0;
 int lcd_scale = 0;
 
 int clk_phase = -1;
-int use_vblank = 0;
+int use_vblank = 1;
 int use_doublebuffer = 0;
+int smi_runpm = 1;
+int smi_msi = 1;
 
 module_param(smi_pat, int, S_IWUSR | S_IRUSR);
 
@@ -105,8 +113,12 @@ module_param_named(lcdscale, lcd_scale, int, 0400);
 
 MODULE_PARM_DESC(clkphase, "Panel Mode Clock phase, -1 = Use Mode table (Default)  0 = Negative 1 = Postive");
 module_param_named(clkphase, clk_phase, int, 0400);
-MODULE_PARM_DESC(vblank, "Disable/Enable hw vblank support");
+MODULE_PARM_DESC(vblank, "Vsync interrupts and vblank timestamps, 0 = disable 1 = enable (default:1)");
 module_param_named(vblank, use_vblank, int, 0400);
+MODULE_PARM_DESC(runpm, "SM768/SM770 gate display clocks when all outputs are off, 0 = disable 1 = enable (default:1)");
+module_param_named(runpm, smi_runpm, int, 0400);
+MODULE_PARM_DESC(msi, "Use MSI instead of the shared INTx line when available, 0 = disable 1 = enable (default:1)");
+module_param_named(msi, smi_msi, int, 0400);
 
 /*
  * This is the generic driver code. This binds the driver to the drm core,
@@ -249,50 +261,108 @@ static void smi_pci_remove(struct pci_dev *pdev)
 
 
 
-static int smi_vram_suspend(struct smi_device *sdev,int vram_size)
+static void smi_vram_free(struct smi_device *sdev)
 {
+	int i, j;
 
-	sdev->vram_save = kvmalloc(vram_size << 20,GFP_KERNEL);
-	if (!sdev->vram_save)			
-		goto malloc_failed;
-	
-	memcpy_fromio(sdev->vram_save, sdev->vram, vram_size << 20);
+	for (i = 0; i < MAX_CRTC_770; i++) {
+		for (j = 0; j < SMI_VRAM_SLOT_NUM; j++) {
+			kvfree(sdev->vram_regions[i][j].save);
+			sdev->vram_regions[i][j].save = NULL;
+		}
+	}
+}
+
+/*
+ * Only save what is being scanned out and cannot be rebuilt. Plane and
+ * cursor images live in shmem and are uploaded again by the resume
+ * commit, so in practice just the VBIOS image not yet replaced by the
+ * first frame is copied out of VRAM.
+ */
+static int smi_vram_suspend(struct smi_device *sdev)
+{
+	struct smi_vram_region *region;
+	int i, j;
+
+	for (i = 0; i < MAX_CRTC_770; i++) {
+		for (j = 0; j < SMI_VRAM_SLOT_NUM; j++) {
+			region = &sdev->vram_regions[i][j];
+			if (!region->size || region->shadowed ||
+			    region->offset + region->size > sdev->vram_size)
+				continue;
+
+			region->save = kvmalloc(region->size, GFP_KERNEL);
+			if (!region->save)
+				goto malloc_failed;
+
+			smi_vram_read(sdev, region->save, region->offset, region->size);
+			dbg_msg("DC%d slot %d: saved 0x%x bytes at 0x%x\n", i, j, region->size, region->offset);
+		}
+	}
 
 	return 0;
 	
 malloc_failed:
-	if (sdev->vram_save) {			
-		kvfree(sdev->vram_save); 		
-		sdev->vram_save = NULL; 	
-	}	
+	smi_vram_free(sdev);
 	return -ENOMEM;
 }
 
-static void smi_vram_resume(struct smi_device *sdev,int vram_size)
+static void smi_vram_resume(struct smi_device *sdev)
 {
-	if (sdev->vram_save) {		
-		memcpy_toio(sdev->vram, sdev->vram_save, vram_size << 20);
-		kvfree(sdev->vram_save); 		
-		sdev->vram_save = NULL; 
+	struct smi_vram_region *region;
+	int i, j;
+
+	for (i = 0; i < MAX_CRTC_770; i++) {
+		for (j = 0; j < SMI_VRAM_SLOT_NUM; j++) {
+			region = &sdev->vram_regions[i][j];
+			if (region->save)
+				memcpy_toio(sdev->vram + region->offset, region->save, region->size);
+		}
 	}
+
+	smi_vram_free(sdev);
 }
 
 
+/* Live HPD lines as USE_* bits, outputs without HPD are left out */
+static int smi_hpd_state(struct smi_device *sdev)
+{
+	int hpd = 0, i;
+
+	if (sdev->specId == SPC_SM768) {
+		if (hdmi_detect() == 1)
+			hpd |= USE_HDMI;
+	} else if (sdev->specId == SPC_SM770) {
+		for (i = 0; i < 3; i++)
+			if (hw770_hdmi_detect(i))
+				hpd |= USE_HDMI0 << i;
+		for (i = 0; i < 2; i++)
+			if (hw770_dp_detect(i))
+				hpd |= USE_DP0 << i;
+	}
+
+	return hpd;
+}
+
 static int smi_drm_freeze(struct drm_device *dev)
 {
 	int ret;
 	struct smi_device *sdev = dev->dev_private;
 	ENTER();
+
+	smi_flush_init_work(sdev);
+	smi_hpd_cancel(sdev);
+	sdev->suspend_hpd = smi_hpd_state(sdev);
 	
 	if (sdev->specId == SPC_SM750){
-		smi_vram_suspend(sdev,16);
+		smi_vram_suspend(sdev);
 		hw750_suspend(sdev->regsave);
 	}else if(sdev->specId == SPC_SM768){
 #ifndef NO_AUDIO
 		if(audio_en)
 			 smi_audio_suspend(sdev);
 #endif
-		smi_vram_suspend(sdev,32);
+		smi_vram_suspend(sdev);
 		hw768_suspend(sdev->regsave_768);
     }else if(sdev->specId == SPC_SM770){
 #ifndef NO_AUDIO
@@ -300,6 +370,7 @@ static int smi_drm_freeze(struct drm_device *dev)
 			 smi_audio_suspend(sdev);
 #endif
 
+		smi_vram_suspend(sdev);
 		hw770_suspend(sdev->regsave_770);
 		hw770_HDMI_Disable_Output(0);
 		hw770_HDMI_Disable_Output(1);
@@ -307,8 +378,10 @@ static int smi_drm_freeze(struct drm_device *dev)
 
     }
 	ret = drm_mode_config_helper_suspend(dev);
-	if (ret)
+	if (ret) {
+		smi_hpd_resume(sdev);
 		return ret;
+	}
 
 
 	pci_save_state(to_pci_dev(dev->dev));
@@ -321,14 +394,17 @@ static int smi_drm_thaw(struct drm_device *dev)
 	struct smi_device *sdev = dev->dev_private;
 
 	ENTER();
+#ifdef SMI_REG_CACHE
+	smi_regcache_invalidate(sdev);
+#endif
 	
 	
 	
 	if(sdev->specId == SPC_SM750){
-		smi_vram_resume(sdev,16);
+		smi_vram_resume(sdev);
 		hw750_resume(sdev->regsave);
 	}else if(sdev->specId == SPC_SM768){
-		smi_vram_resume(sdev,32);
+		smi_vram_resume(sdev);
 		hw768_resume(sdev->regsave_768);
 #ifndef NO_AUDIO
 		if(audio_en)
@@ -345,6 +421,7 @@ static int smi_drm_thaw(struct drm_device *dev)
 			}
 		}
 	}else if(sdev->specId == SPC_SM770){
+				smi_vram_resume(sdev);
 				hw770_resume(sdev->regsave_770);
 #ifndef NO_AUDIO
 				if(audio_en)
@@ -352,6 +429,7 @@ static int smi_drm_thaw(struct drm_device *dev)
 #endif
 
 	}
+	smi_hpd_resume(sdev);
 	
 
 	LEAVE(0);
@@ -362,8 +440,9 @@ static int smi_drm_thaw(struct drm_device *dev)
 
 static int smi_drm_resume(struct drm_device *dev)
 {
-	int ret;
+	int ret, hpd;
 	struct pci_dev *pdev = to_pci_dev(dev->dev);
+	struct smi_device *sdev = dev->dev_private;
 
 	pci_set_power_state(pdev, PCI_D0);
 	pci_restore_state(pdev);
@@ -374,7 +453,23 @@ static int smi_drm_resume(struct drm_device *dev)
 	if (ret)
 		return ret;
 
-	return drm_mode_config_helper_resume(dev);
+	/*
+	 * Thaw put back the channel registers saved at suspend. As long as
+	 * no sink came or went, the replayed commit may keep them (see
+	 * smi_crtc_mode_set_nofb()) and the connectors need no re-probe.
+	 */
+	hpd = smi_hpd_state(sdev);
+	sdev->resume_full = hpd != sdev->suspend_hpd;
+	dbg_msg("resume: hpd 0x%x -> 0x%x\n", sdev->suspend_hpd, hpd);
+
+	sdev->resuming = true;
+	ret = drm_mode_config_helper_resume(dev);
+	sdev->resuming = false;
+
+	if (sdev->resume_full)
+		drm_kms_helper_hotplug_event(dev);
+
+	return ret;
 }
 
 static int smi_pm_suspend(struct device *dev)
@@ -420,6 +515,54 @@ static int smi_pm_poweroff(struct device *dev)
 	return smi_drm_freeze(ddev);
 }
 
+/*
+ * Runtime suspend only gates the display controller clocks. The device
+ * is left in D0 by saving the PCI state here, so register and VRAM
+ * contents survive and HPD interrupts keep coming.
+ */
+static int smi_pm_runtime_suspend(struct device *dev)
+{
+	struct pci_dev *pdev = to_pci_dev(dev);
+	struct drm_device *ddev = pci_get_drvdata(pdev);
+	struct smi_device *sdev = ddev->dev_private;
+
+	if (!sdev->runpm)
+		return -EBUSY;
+
+	/* Retry once the encoders are up. */
+	if (READ_ONCE(sdev->init_pending)) {
+		pm_runtime_mark_last_busy(dev);
+		return -EBUSY;
+	}
+
+	if (sdev->specId == SPC_SM768)
+		sdev->runpm_dc = hw768_gate_dc_clocks();
+	else if (sdev->specId == SPC_SM770)
+		sdev->runpm_dc = hw770_gate_dc_clocks();
+
+	dbg_msg("runtime suspend, DC mask 0x%x gated\n", sdev->runpm_dc);
+	pci_save_state(pdev);
+
+	return 0;
+}
+
+static int smi_pm_runtime_resume(struct device *dev)
+{
+	struct pci_dev *pdev = to_pci_dev(dev);
+	struct drm_device *ddev = pci_get_drvdata(pdev);
+	struct smi_device *sdev = ddev->dev_private;
+
+	if (sdev->specId == SPC_SM768)
+		hw768_ungate_dc_clocks(sdev->runpm_dc);
+	else if (sdev->specId == SPC_SM770)
+		hw770_ungate_dc_clocks(sdev->runpm_dc);
+
+	dbg_msg("runtime resume, DC mask 0x%x ungated\n", sdev->runpm_dc);
+	sdev->runpm_dc = 0;
+
+	return 0;
+}
+
 #if LINUX_VERSION_CODE < KERNEL_VERSION(5, 5, 0)
 static int smi_enable_vblank(struct drm_device *dev, unsigned int pipe)
 {
@@ -449,325 +592,171 @@ static void smi_disable_vblank(struct drm_device *dev, unsigned int pipe)
 }
 #endif
 
-#if LINUX_VERSION_CODE < KERNEL_VERSION(5, 15, 0)
-static void smi_irq_preinstall(struct drm_device *dev)
-{
-	// To Do....
-	/* Disable *all* interrupts */
-
-	/* Clear bits if they're already high */
-}
-
-static int smi_irq_postinstall(struct drm_device *dev)
-{
-	return 0;
-}
-
-static void smi_irq_uninstall(struct drm_device *dev)
-{
-	struct smi_device *sdev = dev->dev_private;
-
-	/* Disable *all* interrupts */
-	if (sdev->specId == SPC_SM750) {
-		ddk750_disable_IntMask();
-	} else if (sdev->specId == SPC_SM768) {
-		ddk768_disable_IntMask();
-	} else if (sdev->specId == SPC_SM770) {
-		ddk770_disable_IntMask();
-	}
-}
-#endif
-
-irqreturn_t smi_drm_interrupt(DRM_IRQ_ARGS)
+/*
+ * One handler for every interrupt source of the chip. The pending sources
+ * are read and acknowledged once, then dispatched by SMI_IRQ_* bit.
+ */
+irqreturn_t smi_irq_handler(DRM_IRQ_ARGS)
 {
 	struct drm_device *dev = (struct drm_device *)arg;
-	int handled = 0;
 	struct smi_device *sdev = dev->dev_private;
+	void (*audio_irq)(void *data);
+	unsigned int pending = 0;
+	int i;
+
+	if (sdev->specId == SPC_SM750)
+		pending = hw750_irq_ack();
+	else if (sdev->specId == SPC_SM768)
+		pending = hw768_irq_ack();
+	else if (sdev->specId == SPC_SM770)
+		pending = hw770_irq_ack();
+
+	if (!pending)
+		return IRQ_NONE;
 
-	if (sdev->specId == SPC_SM750) {
-		if (hw750_check_vsync_interrupt(0)) {
-			/* Clear the panel VSync Interrupt */
-			drm_handle_vblank(dev, 0);
-			handled = 1;
-			hw750_clear_vsync_interrupt(0);
-		}
-		if (hw750_check_vsync_interrupt(1)) {
-			drm_handle_vblank(dev, 1);
-			handled = 1;
-			hw750_clear_vsync_interrupt(1);
-		}
-	} else if (sdev->specId == SPC_SM768) {
-		if (hw768_check_vsync_interrupt(0)) {
-			/* Clear the panel VSync Interrupt */
-			drm_handle_vblank(dev, 0);
-			handled = 1;
-			hw768_clear_vsync_interrupt(0);
-		}
-		if (hw768_check_vsync_interrupt(1)) {
-			drm_handle_vblank(dev, 1);
-			handled = 1;
-			hw768_clear_vsync_interrupt(1);
-		}
-	} else if(sdev->specId == SPC_SM770){
-		if (hw770_check_vsync_interrupt(0)) {
-			/* Clear the panel VSync Interrupt */
-			drm_handle_vblank(dev, 0);
-			handled = 1;
-			hw770_clear_vsync_interrupt(0);
-		}
-		if (hw770_check_vsync_interrupt(1)) {
-			drm_handle_vblank(dev, 1);
-			handled = 1;
-			hw770_clear_vsync_interrupt(1);
+	for (i = 0; use_vblank && i < dev->mode_config.num_crtc; i++) {
+		if (pending & SMI_IRQ_VSYNC(i)) {
+			trace_smi_vblank(i);
+			smi_perf_vblank(sdev, i, dev->vblank[i].framedur_ns);
+			smi_flip_irq(drm_crtc_from_index(dev, i));
+			drm_handle_vblank(dev, i);
 		}
 	}
 
-	if (handled)
-		return IRQ_HANDLED;
-	return IRQ_NONE;
-}
-
-
-irqreturn_t smi_hdmi0_hardirq(int irq, void *dev_id)
-{
-	int ret;
-
-	ret = hw770_check_pnp_interrupt(0);
-	if(!ret)
-		return IRQ_NONE;
-	else if (ret == HDMI_INT_HPD)
-	{
-		return IRQ_WAKE_THREAD;
-	}
-
-	return IRQ_HANDLED;
-}
-
-irqreturn_t smi_hdmi1_hardirq(int irq, void *dev_id)
-{
-	int ret;
-
-	ret = hw770_check_pnp_interrupt(1);
-	if(!ret)
-		return IRQ_NONE;
-	else if (ret == HDMI_INT_HPD)
-	{	
-		return IRQ_WAKE_THREAD;
+	for (i = INDEX_HDMI0; i <= INDEX_HDMI2; i++) {
+		if (!(pending & SMI_IRQ_HDMI(i)) ||
+		    hw770_hdmi_irq(i) != HDMI_INT_HPD ||
+		    READ_ONCE(sdev->hpd_suspended))
+			continue;
+#ifdef ENABLE_HDMI_IRQ
+		/* every edge pushes the detect out again */
+		mod_delayed_work(system_wq, &sdev->hpd[i].work,
+				 msecs_to_jiffies(SMI_HPD_DEBOUNCE_MS));
+#endif
 	}
 
-	return IRQ_HANDLED;
-}
-
-irqreturn_t smi_hdmi2_hardirq(int irq, void *dev_id)
-{
-	int ret;
-
-	ret = hw770_check_pnp_interrupt(2);
-	if(!ret)
-		return IRQ_NONE;
-	else if (ret == HDMI_INT_HPD)
-	{	
-		return IRQ_WAKE_THREAD;
+	/*
+	 * DP hot plug is found by connector polling and the DP sources are
+	 * left masked (DP_Hpd_Interrupt_Enable() is never called). They are
+	 * decoded so an unmasked one shows up here instead of as IRQ_NONE.
+	 */
+	for (i = INDEX_DP0; i <= INDEX_DP1; i++)
+		if (pending & SMI_IRQ_DP(i))
+			dbg_msg("DP%d interrupt, DP hot plug is polled\n", i);
+
+	if (pending & SMI_IRQ_I2S) {
+		audio_irq = READ_ONCE(sdev->audio_irq);
+		if (audio_irq)
+			audio_irq(sdev->audio_data);
 	}
 
 	return IRQ_HANDLED;
 }
 
-
-irqreturn_t smi_hdmi0_pnp_handler(int irq, void *dev_id)
+/*
+ * HDMI hot plug, run SMI_HPD_DEBOUNCE_MS after the last HPD edge so a
+ * cable wiggle ends up as one detect. A sink that is back gets the mode of
+ * its CRTC programmed again, then only this connector is re-probed.
+ */
+static void smi_hdmi_hpd_work(struct work_struct *work)
 {
+	struct smi_hpd_work *hpd = container_of(to_delayed_work(work), struct smi_hpd_work, work);
+	struct smi_device *sdev = hpd->sdev;
+	struct drm_device *dev = sdev->dev;
+	int index = hpd->index;
+	struct drm_connector *connector;
 	struct drm_display_mode *mode;
-	struct smi_device *sdev;
-	struct drm_device *dev;
+	struct drm_crtc *crtc;
+	struct edid *edid;
 	logicalMode_t logicalMode;
-	unsigned long refresh_rate;
-	struct drm_crtc *crtc0;
 	struct smi_770_fb_info fb_info = {0};
-	int monitor_status = 0;
-	int ret = 0;
-
-	dev = dev_id;
-	sdev = dev->dev_private;
-	msleep(1500);
-	monitor_status = hw770_hdmi_detect(0);
-	if(!monitor_status)
-	{
-		drm_kms_helper_hotplug_event(dev);
-		return IRQ_HANDLED;
-	}
-	crtc0 = sdev->smi_enc_tab[2]->crtc;
-	if (crtc0) {
-		dbg_msg("CRTC0 found: %p\n", crtc0);
-	} else {
-		dbg_msg("CRTC0 not found\n");
-		goto error;
+	int monitor_status, ret;
+
+	/* queued by an edge that raced with smi_hpd_cancel() */
+	if (READ_ONCE(sdev->hpd_suspended))
+		return;
+
+	connector = sdev->smi_conn_tab[index + 2];
+
+	monitor_status = hw770_hdmi_detect(index);
+	trace_smi_hpd(index, monitor_status);
+	if (!monitor_status)
+		goto probe;
+
+	if (index == INDEX_HDMI0)
+		edid = sdev->hdmi0_edid;
+	else if (index == INDEX_HDMI1)
+		edid = sdev->hdmi1_edid;
+	else
+		edid = sdev->hdmi2_edid;
+
+	drm_modeset_lock_all(dev);
+	mutex_lock(&sdev->hw_lock);
+	crtc = sdev->smi_enc_tab[index + 2]->crtc;
+	if (!crtc || !crtc->state->active) {
+		dbg_msg("HDMI%d has no active CRTC\n", index);
+		goto unlock;
 	}
 
-	mode = &crtc0->state->adjusted_mode;
-
-	if(!mode)
-		goto error;
-
-	refresh_rate = drm_mode_vrefresh(mode);
-	hw770_get_current_fb_info(0,&fb_info);
+	mode = &crtc->state->adjusted_mode;
+	hw770_get_current_fb_info(index, &fb_info);
 
 	logicalMode.valid_edid = false;
-	if (sdev->hdmi0_edid && drm_edid_header_is_valid((u8 *)sdev->hdmi0_edid) == 8)
+	if (edid && drm_edid_header_is_valid((u8 *)edid) == 8)
 		logicalMode.valid_edid = true;
 
 	logicalMode.x = mode->hdisplay;
 	logicalMode.y = mode->vdisplay;
 	logicalMode.bpp = smi_bpp;
-	logicalMode.hz = refresh_rate;
+	logicalMode.hz = drm_mode_vrefresh(mode);
 	logicalMode.pitch = 0;
-	logicalMode.dispCtrl = 0;
-
-	dbg_msg("HDMI0 reset mode: Monitor status is 0x%x\n", monitor_status);
-		hw770_setMode(&logicalMode, *mode);
-		ret = hw770_set_hdmi_mode(&logicalMode, *mode, sdev->is_hdmi[0], INDEX_HDMI0);
-		if (ret != 0)
-		{
-			dbg_msg("HDMI Mode not supported!\n");
-			goto error;
-		}
-		hw770_set_current_pitch((disp_control_t)INDEX_HDMI0,&fb_info);
-	
-	return IRQ_HANDLED;
-error:
-	return IRQ_HANDLED;
-
+	logicalMode.dispCtrl = index;
+
+	dbg_msg("HDMI%d reset mode: Monitor status is 0x%x\n", index, monitor_status);
+	hw770_setMode(&logicalMode, *mode);
+	ret = hw770_set_hdmi_mode(&logicalMode, *mode, sdev->is_hdmi[index], index);
+	if (ret != 0) {
+		dbg_msg("HDMI Mode not supported!\n");
+		goto unlock;
+	}
+	hw770_set_current_pitch((disp_control_t)index, &fb_info);
+unlock:
+	mutex_unlock(&sdev->hw_lock);
+	drm_modeset_unlock_all(dev);
+probe:
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 17, 0)
+	if (connector)
+		drm_connector_helper_hpd_irq_event(connector);
+#else
+	drm_helper_hpd_irq_event(dev);
+#endif
 }
 
-irqreturn_t smi_hdmi1_pnp_handler(int irq, void *dev_id)
+void smi_hpd_init(struct smi_device *sdev)
 {
-	struct drm_display_mode *mode;
-	struct smi_device *sdev;
-	struct drm_device *dev;
-	logicalMode_t logicalMode;
-	unsigned long refresh_rate;
-	struct drm_crtc *crtc1;
-	struct smi_770_fb_info fb_info = {0};
+	int i;
 
-	int monitor_status = 0;
-	int ret = 0;
-
-	dev = dev_id;
-	sdev = dev->dev_private;
-	msleep(1500);
-	monitor_status = hw770_hdmi_detect(1);
-	if(!monitor_status)
-	{
-		drm_kms_helper_hotplug_event(dev);
-		return IRQ_HANDLED;
-	}
-	crtc1 = sdev->smi_enc_tab[3]->crtc;
-	if (crtc1) {
-		dbg_msg("CRTC1 found: %p\n", crtc1);
-	} else {
-		dbg_msg("CRTC1 not found\n");
-		goto error;
+	for (i = INDEX_HDMI0; i <= INDEX_HDMI2; i++) {
+		sdev->hpd[i].sdev = sdev;
+		sdev->hpd[i].index = i;
+		INIT_DELAYED_WORK(&sdev->hpd[i].work, smi_hdmi_hpd_work);
 	}
-
-
-	mode = &crtc1->state->adjusted_mode;
-
-	if(!mode)
-		goto error;
-
-	refresh_rate = drm_mode_vrefresh(mode);
-	hw770_get_current_fb_info(1,&fb_info);
-	logicalMode.valid_edid = false;
-	if (sdev->hdmi1_edid && drm_edid_header_is_valid((u8 *)sdev->hdmi1_edid) == 8)
-		logicalMode.valid_edid = true;
-
-	logicalMode.x = mode->hdisplay;
-	logicalMode.y = mode->vdisplay;
-	logicalMode.bpp = smi_bpp;
-	logicalMode.hz = refresh_rate;
-	logicalMode.pitch = 0;
-	logicalMode.dispCtrl = 1;
-
-	
-	dbg_msg("HDMI1 reset mode: Monitor status is 0x%x\n", monitor_status);
-		hw770_setMode(&logicalMode, *mode);
-		ret = hw770_set_hdmi_mode(&logicalMode, *mode, sdev->is_hdmi[1], INDEX_HDMI1);
-		if (ret != 0)
-		{
-			dbg_msg("HDMI Mode not supported!\n");
-			goto error;
-		}
-		hw770_set_current_pitch((disp_control_t)INDEX_HDMI1,&fb_info);
-	
-	return IRQ_HANDLED;
-error:
-	return IRQ_HANDLED;
-
 }
 
-irqreturn_t smi_hdmi2_pnp_handler(int irq, void *dev_id)
+/* Nothing may touch the HDMI blocks after this, until smi_hpd_resume() */
+void smi_hpd_cancel(struct smi_device *sdev)
 {
-	struct drm_display_mode *mode;
-	struct smi_device *sdev;
-	struct drm_device *dev;
-	logicalMode_t logicalMode;
-	unsigned long refresh_rate;
-	struct drm_crtc *crtc2;
-	struct smi_770_fb_info fb_info = {0};
-	int monitor_status = 0;
-	int ret = 0;
-
-	dev = dev_id;
-	sdev = dev->dev_private;
-	msleep(1500);
-	monitor_status = hw770_hdmi_detect(2);
-	if(!monitor_status)
-	{
-		drm_kms_helper_hotplug_event(dev);
-		return IRQ_HANDLED;
-	}
-	crtc2 = sdev->smi_enc_tab[4]->crtc;
-	if (crtc2) {
-		dbg_msg("CRTC2 found: %p\n", crtc2);
-	} else {
-		dbg_msg("CRTC2 not found\n");
-		goto error;
-	}
-
-
-	mode = &crtc2->state->adjusted_mode;
-
-	if(!mode)
-		goto error;
+	int i;
 
-	refresh_rate = drm_mode_vrefresh(mode);
-	hw770_get_current_fb_info(2,&fb_info);
-	logicalMode.valid_edid = false;
-	if (sdev->hdmi2_edid && drm_edid_header_is_valid((u8 *)sdev->hdmi2_edid) == 8)
-		logicalMode.valid_edid = true;
-
-	logicalMode.x = mode->hdisplay;
-	logicalMode.y = mode->vdisplay;
-	logicalMode.bpp = smi_bpp;
-	logicalMode.hz = refresh_rate;
-	logicalMode.pitch = 0;
-	logicalMode.dispCtrl = 2;
-
-
-	
-	dbg_msg("HDMI2 reset mode: Monitor status is 0x%x\n", monitor_status);
-		hw770_setMode(&logicalMode, *mode);
-		ret = hw770_set_hdmi_mode(&logicalMode, *mode, sdev->is_hdmi[2], INDEX_HDMI2);
-		if (ret != 0)
-		{
-			dbg_msg("HDMI Mode not supported!\n");
-			goto error;
-		}
-		hw770_set_current_pitch((disp_control_t)INDEX_HDMI2,&fb_info);
-	
-	return IRQ_HANDLED;
-error:
-	return IRQ_HANDLED;
+	/* the IRQ is still live, keep it from queueing the work again */
+	WRITE_ONCE(sdev->hpd_suspended, true);
+	for (i = INDEX_HDMI0; i <= INDEX_HDMI2; i++)
+		cancel_delayed_work_sync(&sdev->hpd[i].work);
+}
 
+void smi_hpd_resume(struct smi_device *sdev)
+{
+	WRITE_ONCE(sdev->hpd_suspended, false);
 }
 
 
@@ -794,6 +783,8 @@ static const struct dev_pm_ops smi_pm_ops = {
 	.thaw = smi_pm_thaw,
 	.poweroff = smi_pm_poweroff,
 	.restore = smi_pm_resume,
+	.runtime_suspend = smi_pm_runtime_suspend,
+	.runtime_resume = smi_pm_runtime_resume,
 };
 
 static struct pci_driver smi_pci_driver = {
@@ -846,12 +837,6 @@ static struct drm_driver driver = {
 	.enable_vblank = smi_enable_vblank,
 	.disable_vblank = smi_disable_vblank,
 #endif
-#if LINUX_VERSION_CODE < KERNEL_VERSION(5, 15, 0)
-	.irq_preinstall = smi_irq_preinstall,
-	.irq_postinstall = smi_irq_postinstall,
-	.irq_uninstall = smi_irq_uninstall,
-	.irq_handler = smi_drm_interrupt,
-#endif
 #if LINUX_VERSION_CODE < KERNEL_VERSION(6, 6, 0)
 	.prime_handle_to_fd = drm_gem_prime_handle_to_fd,
 	.prime_fd_to_handle = drm_gem_prime_fd_to_handle,
@@ -37,6 +37,8 @@
 #define DRIVER_PATCHLEVEL	0
 
 #define SMIFB_CONN_LIMIT 3
+#define SMI_AUDIO_SINKS 5	/* SM770 HDMI0-2, DP0-1, in hw770 audio route order */
+#define SMI_AUDIO_SINK_DP(x)	(3 + (x))
 
 
 
@@ -103,6 +105,8 @@ extern int edid_mode;
 extern int lcd_scale;
 extern int use_vblank;
 extern int use_doublebuffer;
+extern int smi_runpm;
+extern int smi_msi;
 
 struct smi_750_register;
 struct smi_768_register;
@@ -127,6 +131,51 @@ static inline struct smi_plane *to_smi_plane(struct drm_plane *plane)
 	return container_of(plane, struct smi_plane, base);
 }
 
+/* Device init deferred out of probe, one work item each */
+enum smi_init_item {
+	SMI_INIT_DVI,		/* DVI/LVDS encoder chips and backlight */
+	SMI_INIT_HDMI,
+	SMI_INIT_DP,
+	SMI_INIT_AUDIO,
+	SMI_INIT_NUM
+};
+
+#define SMI_HDMI_NUM 3	/* SM770 HDMI0-2 */
+
+/* HDMI hot plug is handled this long after the last HPD edge */
+#define SMI_HPD_DEBOUNCE_MS 1500
+
+struct smi_hpd_work {
+	struct delayed_work work;
+	struct smi_device *sdev;
+	int index;		/* hdmi_index */
+};
+
+/* Scan-out left running on a channel by the VBIOS, adopted at load */
+struct smi_boot_fb {
+	u32 x, y;
+	u32 bpp;	/* 0 when there is nothing to adopt */
+	u32 base;
+	u32 pitch;
+};
+
+/* VRAM ranges in use per display channel, see smi_vram_suspend() */
+enum smi_vram_slot {
+	SMI_VRAM_PRIMARY,
+	SMI_VRAM_CURSOR,
+	SMI_VRAM_BOOT,
+	SMI_VRAM_SLOT_NUM
+};
+
+struct smi_vram_region {
+	u32 offset;
+	u32 size;	/* 0 when the slot is unused */
+	bool shadowed;	/* the resume commit rebuilds it from a shmem buffer */
+	void *save;
+};
+
+struct smi_perf;
+
 struct smi_device {
 	struct drm_device *dev;
 	struct snd_card 		*card;	
@@ -152,7 +201,7 @@ struct smi_device {
 	int fb_mtrr;
 	bool need_dma32;
 	bool mm_inited;
-	void *vram_save;
+	struct smi_vram_region vram_regions[MAX_CRTC_770][SMI_VRAM_SLOT_NUM];
 	union {
 		struct smi_750_register *regsave;
 		struct smi_768_register *regsave_768;
@@ -182,7 +231,32 @@ struct smi_device {
 	struct drm_display_mode *fixed_mode;
 	bool is_768hdmi;
 	bool is_hdmi[SMIFB_CONN_LIMIT];
+	spinlock_t eld_lock;
+	u8 eld[SMI_AUDIO_SINKS][MAX_ELD_BYTES];	/* sink ELDs, built from the EDIDs */
 	bool is_boot_gpu;
+	struct smi_boot_fb boot_fb[MAX_CRTC_770];
+	bool resuming;		/* set while resume replays the suspended state */
+	bool resume_full;	/* HPD changed while asleep, no resume fast path */
+	int suspend_hpd;	/* USE_* bits with HPD asserted at suspend */
+	bool runpm;		/* runtime PM enabled for this device */
+	int runpm_dc;		/* DCs clock gated by runtime suspend */
+
+	bool irq_enabled;	/* smi_irq_handler installed */
+	int irq;		/* MSI vector or the INTx line */
+	struct smi_hpd_work hpd[SMI_HDMI_NUM];	/* SM770 HDMI hot plug */
+	bool hpd_suspended;	/* freeze to thaw: HPD edges are dropped */
+	void (*audio_irq)(void *data);	/* I2S consumer of smi_irq_handler */
+	void *audio_data;
+
+	struct smi_perf *perf;		/* debugfs perf/ counters, NULL if not allocated */
+
+	struct workqueue_struct *init_wq;	/* ordered, runs init_work[] in turn */
+	struct work_struct init_work[SMI_INIT_NUM];
+	unsigned long init_pending;	/* BIT(smi_init_item) until that init is done */
+	struct mutex hw_lock;	/* DDK I2C/GPIO state: init work, probing and modesets */
+	void *readback;		/* SM750 VRAM readback bounce buffer, below 4GB */
+	dma_addr_t readback_dma;
+	u32 capture_ctrl;	/* DC the debugfs capture file snapshots */
 
 };
 
@@ -213,6 +287,14 @@ static inline struct smi_connector *to_smi_connector(struct drm_connector *conne
 	return container_of(connector, struct smi_connector, base);
 }
 
+static inline void smi_vram_track(struct smi_device *sdev, int ctrl, enum smi_vram_slot slot,
+				  u32 offset, u32 size, bool shadowed)
+{
+	sdev->vram_regions[ctrl][slot].offset = offset;
+	sdev->vram_regions[ctrl][slot].size = size;
+	sdev->vram_regions[ctrl][slot].shadowed = shadowed;
+}
+
 
 
 /* smi_main.c */
@@ -221,6 +303,8 @@ int smi_device_init(struct smi_device *cdev, struct drm_device *ddev, struct pci
 void smi_device_fini(struct smi_device *cdev);
 int smi_driver_load(struct drm_device *dev, unsigned long flags);
 void smi_driver_unload(struct drm_device *dev);
+void smi_flush_init_work(struct smi_device *sdev);
+int smi_vram_read(struct smi_device *sdev, void *dst, u32 offset, u32 size);
 
 void smi_gem_free_object(struct drm_gem_object *obj);
 
@@ -233,6 +317,10 @@ int smi_modeset_init(struct smi_device *cdev);
 void smi_modeset_fini(struct smi_device *cdev);
 int smi_calc_hdmi_ctrl(int m_connector);
 int smi_encoder_crtc_index_changed(int encoder_index);
+void smi_flip_set_base(struct drm_crtc *crtc, int ctrl, int pitch, int offset, u64 vbl);
+void smi_flip_set_cursor(struct drm_crtc *crtc, int ctrl, unsigned long x, unsigned long y,
+			 unsigned char top, unsigned char left, unsigned int prefetch);
+void smi_flip_irq(struct drm_crtc *crtc);
 
 #define to_smi_crtc(x) container_of(x, struct smi_crtc, base)
 #define to_smi_encoder(x) container_of(x, struct smi_encoder, base)
@@ -262,14 +350,10 @@ void smi_pwm_remove(struct drm_device *ddev);
 #define DRM_IRQ_ARGS int irq, void *arg
 #endif
 
-irqreturn_t smi_drm_interrupt(DRM_IRQ_ARGS);
-
-irqreturn_t smi_hdmi0_pnp_handler(int irq, void *dev_id);
-irqreturn_t smi_hdmi0_hardirq(int irq, void *dev_id);
-irqreturn_t smi_hdmi1_pnp_handler(int irq, void *dev_id);
-irqreturn_t smi_hdmi1_hardirq(int irq, void *dev_id);
-irqreturn_t smi_hdmi2_pnp_handler(int irq, void *dev_id);
-irqreturn_t smi_hdmi2_hardirq(int irq, void *dev_id);
+irqreturn_t smi_irq_handler(DRM_IRQ_ARGS);
+void smi_hpd_init(struct smi_device *sdev);
+void smi_hpd_cancel(struct smi_device *sdev);
+void smi_hpd_resume(struct smi_device *sdev);
 
 #define smi_LUT_SIZE 256
 #define CURSOR_WIDTH 64
@@ -18,6 +18,7 @@
 #include <drm/drm_crtc_helper.h>
 #include <drm/drm_fourcc.h>
 #include <linux/dma-buf.h>
+#include <linux/pm_runtime.h>
 #include <drm/drm_probe_helper.h>
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 0, 0)
 #include <drm/drm_framebuffer.h>
@@ -27,14 +28,51 @@
 #include "hw768.h"
 #include "hw770.h"
 #include "smi_dbg.h"
+#include "smi_perf.h"
+#if defined(SMI_REG_TRACE) || defined(SMI_REG_CACHE)
+#include "smi_regs.h"
+#endif
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 8, 0)
+#define SMI_PCI_IRQ_INTX PCI_IRQ_INTX
+#else
+#define SMI_PCI_IRQ_INTX PCI_IRQ_LEGACY
+#endif
 
 static const struct drm_framebuffer_funcs smi_fb_funcs = {
 	.create_handle = drm_gem_fb_create_handle,
 	.destroy = drm_gem_fb_destroy,
 };
 
+/*
+ * The device is held awake for the duration of every commit, and for as
+ * long as any CRTC is active. Runtime suspend is only reached once the
+ * last CRTC is switched off.
+ */
+static void smi_atomic_commit_tail(struct drm_atomic_state *state)
+{
+	struct drm_device *dev = state->dev;
+	struct drm_crtc_state *old_crtc_state, *new_crtc_state;
+	struct drm_crtc *crtc;
+	int i;
+
+	pm_runtime_get_sync(dev->dev);
+
+	drm_atomic_helper_commit_tail(state);
+
+	for_each_oldnew_crtc_in_state(state, crtc, old_crtc_state, new_crtc_state, i) {
+		if (!old_crtc_state->active && new_crtc_state->active)
+			pm_runtime_get_noresume(dev->dev);
+		else if (old_crtc_state->active && !new_crtc_state->active)
+			pm_runtime_put_noidle(dev->dev);
+	}
+
+	pm_runtime_mark_last_busy(dev->dev);
+	pm_runtime_put_autosuspend(dev->dev);
+}
+
 static const struct drm_mode_config_helper_funcs smi_mode_config_helper_funcs = {
-	.atomic_commit_tail = drm_atomic_helper_commit_tail,
+	.atomic_commit_tail = smi_atomic_commit_tail,
 };
 
 static const struct drm_mode_config_funcs smi_mode_config_funcs = {
@@ -47,6 +85,161 @@ static const struct drm_mode_config_funcs smi_mode_config_funcs = {
 };
 
 
+/*
+ * Record what the VBIOS is scanning out on each channel, so the first
+ * modeset can keep the timing running and the first fbdev frame can
+ * start from the firmware image instead of a blank screen.
+ */
+static void smi_adopt_boot_fb(struct smi_device *cdev)
+{
+	logicalMode_t logicalMode;
+	int i;
+
+	for (i = 0; i < MAX_CRTC_768; i++) {
+		memset(&logicalMode, 0, sizeof(logicalMode));
+		logicalMode.dispCtrl = i;
+		if (hw768_get_current_mode(&logicalMode))
+			continue;
+
+		cdev->boot_fb[i].x = logicalMode.x;
+		cdev->boot_fb[i].y = logicalMode.y;
+		cdev->boot_fb[i].bpp = logicalMode.bpp;
+		cdev->boot_fb[i].base = logicalMode.baseAddress;
+		cdev->boot_fb[i].pitch = logicalMode.pitch;
+		smi_vram_track(cdev, i, SMI_VRAM_BOOT, logicalMode.baseAddress,
+			       logicalMode.pitch * logicalMode.y, false);
+		dbg_msg("DC%d boot mode %lux%lu-%lu base 0x%lx pitch %lu\n", i, logicalMode.x, logicalMode.y,
+			logicalMode.bpp, logicalMode.baseAddress, logicalMode.pitch);
+	}
+}
+
+static void smi_init_done(struct smi_device *cdev, enum smi_init_item item)
+{
+	clear_bit(item, &cdev->init_pending);
+	if (item != SMI_INIT_AUDIO)
+		drm_kms_helper_hotplug_event(cdev->dev);
+}
+
+/* Encoder chips on the DVI/LVDS path and the panel backlight */
+static void smi_dvi_init_work(struct work_struct *work)
+{
+	struct smi_device *cdev = container_of(work, struct smi_device, init_work[SMI_INIT_DVI]);
+	int r __attribute__((unused));
+
+	mutex_lock(&cdev->hw_lock);
+	if (cdev->specId == SPC_SM750) {
+#ifdef USE_HDMICHIP
+		if((r = sii9022xInitChip()) < 0)
+			printk("Init HDMI-Tx chip failed!");
+#endif
+#ifdef USE_EP952
+		EP_HDMI_Init(0);
+		EP_HDMI_Set_Video_Timing(1,0);
+#endif
+	} else if (cdev->specId == SPC_SM768) {
+		smi_pwm_init(cdev->dev);
+#ifdef USE_LT8618
+		hw768_init_lt8618();
+#endif
+	}
+	mutex_unlock(&cdev->hw_lock);
+
+	smi_init_done(cdev, SMI_INIT_DVI);
+}
+
+static void smi_hdmi_init_work(struct work_struct *work)
+{
+	struct smi_device *cdev = container_of(work, struct smi_device, init_work[SMI_INIT_HDMI]);
+
+	mutex_lock(&cdev->hw_lock);
+	if (cdev->specId == SPC_SM768) {
+		HDMI_Init();
+#ifdef USE_EP952
+		EP_HDMI_Init(1);
+		EP_HDMI_Set_Video_Timing(1,1);
+#endif
+	} else if (cdev->specId == SPC_SM770) {
+		hw770_init_hdmi();
+	}
+	mutex_unlock(&cdev->hw_lock);
+
+	smi_init_done(cdev, SMI_INIT_HDMI);
+}
+
+static void smi_dp_init_work(struct work_struct *work)
+{
+	struct smi_device *cdev = container_of(work, struct smi_device, init_work[SMI_INIT_DP]);
+
+	mutex_lock(&cdev->hw_lock);
+	if (cdev->specId == SPC_SM770)
+		hw770_init_dp();
+	mutex_unlock(&cdev->hw_lock);
+
+	smi_init_done(cdev, SMI_INIT_DP);
+}
+
+static void smi_audio_init_work(struct work_struct *work)
+{
+	struct smi_device *cdev = container_of(work, struct smi_device, init_work[SMI_INIT_AUDIO]);
+
+	/* HDMI audio is carried by the HDMI TX, init_wq ran that item first. */
+	mutex_lock(&cdev->hw_lock);
+	if (cdev->specId == SPC_SM770)
+		ddk770_iis_Init();
+
+	if ((cdev->specId == SPC_SM768 || cdev->specId == SPC_SM770) && audio_en)
+		smi_audio_init(cdev->dev);
+	mutex_unlock(&cdev->hw_lock);
+
+	smi_init_done(cdev, SMI_INIT_AUDIO);
+}
+
+/* Wait for all deferred init, before teardown or suspend touch the same blocks. */
+void smi_flush_init_work(struct smi_device *cdev)
+{
+	int i;
+
+	for (i = 0; i < SMI_INIT_NUM; i++)
+		flush_work(&cdev->init_work[i]);
+}
+
+#define SMI_READBACK_CHUNK	(1 << 20)
+
+/*
+ * Read VRAM back into system memory. On SM750 the 2D engine can write to
+ * the host through the PCI master window, which is far faster than CPU
+ * reads across the write-combined BAR. SM768/SM770 have no host target
+ * for the 2D engine, so those chips and any unaligned tail use
+ * memcpy_fromio.
+ */
+int smi_vram_read(struct smi_device *cdev, void *dst, u32 offset, u32 size)
+{
+	u32 len, done = 0;
+
+	if (offset > cdev->vram_size || size > cdev->vram_size - offset)
+		return -EINVAL;
+
+	if (cdev->readback && size >= HW750_READBACK_PITCH) {
+		/* one bounce buffer and one 2D engine */
+		mutex_lock(&cdev->hw_lock);
+		while (size - done >= HW750_READBACK_PITCH) {
+			len = min_t(u32, rounddown(size - done, HW750_READBACK_PITCH),
+				    SMI_READBACK_CHUNK);
+			if (hw750_vram_readback(cdev->readback_dma, offset + done, len))
+				break;
+			memcpy(dst + done, cdev->readback, len);
+			done += len;
+		}
+		mutex_unlock(&cdev->hw_lock);
+		dbg_msg("DMA readback 0x%x of 0x%x bytes at 0x%x\n", done, size, offset);
+	}
+
+	if (done < size)
+		memcpy_fromio(dst + done, cdev->vram + offset + done, size - done);
+
+	return 0;
+}
+
 /*
  * Functions here will be called by the core once it's bound the driver to
  * a PCI device
@@ -55,7 +248,7 @@ int smi_driver_load(struct drm_device *dev, unsigned long flags)
 {
 	struct smi_device *cdev;
 	struct pci_dev *pdev; 
-	int r;
+	int r, i;
 	
 	pdev = to_pci_dev(dev->dev);
 	cdev = kzalloc(sizeof(struct smi_device), GFP_KERNEL);
@@ -63,6 +256,20 @@ int smi_driver_load(struct drm_device *dev, unsigned long flags)
 		return -ENOMEM;
 	dev->dev_private = (void *)cdev;
 
+	spin_lock_init(&cdev->eld_lock);
+	mutex_init(&cdev->hw_lock);
+	cdev->init_wq = alloc_ordered_workqueue("smi_init", 0);
+	if (!cdev->init_wq) {
+		kfree(cdev);
+		dev->dev_private = NULL;
+		return -ENOMEM;
+	}
+	INIT_WORK(&cdev->init_work[SMI_INIT_DVI], smi_dvi_init_work);
+	INIT_WORK(&cdev->init_work[SMI_INIT_HDMI], smi_hdmi_init_work);
+	INIT_WORK(&cdev->init_work[SMI_INIT_DP], smi_dp_init_work);
+	INIT_WORK(&cdev->init_work[SMI_INIT_AUDIO], smi_audio_init_work);
+	smi_hpd_init(cdev);
+
 	switch (pdev->device) {
 	case PCI_DEVID_LYNX_EXP:
 		cdev->specId = SPC_SM750;
@@ -84,68 +291,69 @@ int smi_driver_load(struct drm_device *dev, unsigned long flags)
 		dev_err(&pdev->dev, "Fatal error during GPU init: %d\n", r);
 		goto out;
 	}
+#ifdef SMI_REG_CACHE
+	if (smi_regcache_init(cdev))
+		DRM_ERROR("cannot allocate register cache\n");
+#endif
+	if (pdev->resource[PCI_ROM_RESOURCE].flags & IORESOURCE_ROM_SHADOW) {
+		cdev->is_boot_gpu = true;
+	}
+
 	if(cdev->specId == SPC_SM750)
 	{
-	    if (pdev->resource[PCI_ROM_RESOURCE].flags & IORESOURCE_ROM_SHADOW) {
-			cdev->is_boot_gpu = true;
-		}
 		ddk750_initChip();
 		ddk750_deInit();
-		
-#ifdef USE_HDMICHIP
-		if((r = sii9022xInitChip()) < 0)
-		{	
-			printk("Init HDMI-Tx chip failed!");
-			r = 0;	
+
+		/* Keep the VBIOS display lit until the first modeset. */
+		if (!cdev->is_boot_gpu) {
+			setDisplayControl(CHANNEL0_CTRL, DISP_OFF);
+			setDisplayControl(CHANNEL1_CTRL, DISP_OFF);
 		}
-#endif
-#ifdef USE_EP952
-		EP_HDMI_Init(0);
-		EP_HDMI_Set_Video_Timing(1,0);
-#endif
-		setDisplayControl(CHANNEL0_CTRL, DISP_OFF);
-		setDisplayControl(CHANNEL1_CTRL, DISP_OFF);
 	}
 	else if(cdev->specId == SPC_SM768)
 	{
 		ddk768_initChip();
 		ddk768_deInit();
-		HDMI_Init();
-#ifdef USE_EP952
-		EP_HDMI_Init(1);
-		EP_HDMI_Set_Video_Timing(1,1);
-#endif
-		smi_pwm_init(dev);	
-
-#ifdef USE_LT8618
-		hw768_init_lt8618();
-#endif
+		if (cdev->is_boot_gpu)
+			smi_adopt_boot_fb(cdev);
 	}
 	else if(cdev->specId == SPC_SM770){
 		ddk770_initChip();
-		ddk770_iis_Init();
-		
-		hw770_init_hdmi();
-
-		hw770_init_dp();
-
 	}
 
-	if((cdev->specId == SPC_SM768 || cdev->specId == SPC_SM770) && audio_en)
-			smi_audio_init(dev);
+	if (smi_perf_init(cdev))
+		DRM_ERROR("cannot allocate perf counters\n");
+
+	/*
+	 * vblank, HDMI hot plug and I2S all share this one handler. With MSI
+	 * the vector is ours alone, else the INTx line may be shared.
+	 */
+	r = pci_alloc_irq_vectors(pdev, 1, 1, smi_msi ? PCI_IRQ_MSI | SMI_PCI_IRQ_INTX : SMI_PCI_IRQ_INTX);
+	if (r < 0) {
+		DRM_ERROR("cannot allocate irq vector, ret = %d\n", r);
+		cdev->irq = pdev->irq;
+	} else {
+		cdev->irq = pci_irq_vector(pdev, 0);
+	}
+	dbg_msg("irq %d, %s\n", cdev->irq, pdev->msi_enabled ? "MSI" : "INTx");
 
-	if (use_vblank) {
-		drm_vblank_init(dev, dev->mode_config.num_crtc);
+	r = request_irq(cdev->irq, smi_irq_handler,
+			pdev->msi_enabled ? 0 : IRQF_SHARED, KBUILD_MODNAME, dev);
+	if (r) {
+		DRM_ERROR("install irq failed , ret = %d\n", r);
+		pci_free_irq_vectors(pdev);
+	} else {
+		cdev->irq_enabled = true;
+	}
 
+	/* the CRTCs do not exist yet, size vblank by what modeset_init makes */
+	if (use_vblank && (!cdev->irq_enabled || drm_vblank_init(dev, cdev->num_crtc))) {
+		DRM_INFO("vblank interrupts disabled\n");
+		use_vblank = 0;
+	}
 #if LINUX_VERSION_CODE < KERNEL_VERSION(5, 15, 0)
-		r = drm_irq_install(dev, pdev->irq);
-#else
-		r = request_irq(pdev->irq, smi_drm_interrupt, IRQF_SHARED,
-					KBUILD_MODNAME, dev);
+	dev->irq_enabled = use_vblank;
 #endif
-		if (r)
-			DRM_ERROR("install irq failed , ret = %d\n", r);
-	}
 
 	dev->mode_config.funcs = (void *)&smi_mode_config_funcs;
 	r = smi_modeset_init(cdev);
@@ -153,29 +361,6 @@ int smi_driver_load(struct drm_device *dev, unsigned long flags)
 		DRM_ERROR("Fatal error during modeset init: %d\n", r);
 		goto out;
 	}
-#ifdef ENABLE_HDMI_IRQ
-	if (cdev->specId == SPC_SM770)
-	{
-
-		r = devm_request_threaded_irq(cdev->dev->dev, pdev->irq, smi_hdmi0_hardirq,
-									  smi_hdmi0_pnp_handler, IRQF_SHARED,
-									  dev_name(cdev->dev->dev), cdev->dev);
-		if (r)
-			DRM_ERROR("install irq failed , ret = %d\n", r);
-
-		r = devm_request_threaded_irq(cdev->dev->dev, pdev->irq, smi_hdmi1_hardirq,
-									  smi_hdmi1_pnp_handler, IRQF_SHARED,
-									  dev_name(cdev->dev->dev), cdev->dev);
-		if (r)
-			DRM_ERROR("install irq failed , ret = %d\n", r);
-
-		r = devm_request_threaded_irq(cdev->dev->dev, pdev->irq, smi_hdmi2_hardirq,
-									  smi_hdmi2_pnp_handler, IRQF_SHARED,
-									  dev_name(cdev->dev->dev), cdev->dev);
-		if (r)
-			DRM_ERROR("install irq failed , ret = %d\n", r);
-	}
-#endif
 	cdev->regsave = kvmalloc(1024,GFP_KERNEL);
 	if (!cdev->regsave) {
 		DRM_ERROR("cannot allocate regsave\n");
@@ -184,6 +369,26 @@ int smi_driver_load(struct drm_device *dev, unsigned long flags)
 
 	drm_kms_helper_poll_init(dev);
 
+	/*
+	 * Scan-out is ready. Encoder PHYs, codecs and audio come up in the
+	 * background, one after the other in smi_init_item order, their
+	 * connectors report disconnected until then.
+	 */
+	for (i = 0; i < SMI_INIT_NUM; i++) {
+		set_bit(i, &cdev->init_pending);
+		queue_work(cdev->init_wq, &cdev->init_work[i]);
+	}
+
+	/* Drop the reference the PCI core holds across probe. */
+	if (cdev->specId != SPC_SM750 && smi_runpm) {
+		cdev->runpm = true;
+		pm_runtime_use_autosuspend(dev->dev);
+		pm_runtime_set_autosuspend_delay(dev->dev, 5000);
+		pm_runtime_allow(dev->dev);
+		pm_runtime_mark_last_busy(dev->dev);
+		pm_runtime_put_autosuspend(dev->dev);
+	}
+
 	return 0;
 out:
 	if (r)
@@ -194,18 +399,26 @@ out:
 void smi_driver_unload(struct drm_device *dev)
 {
 	struct smi_device *cdev = dev->dev_private;
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 15, 0)
 	struct pci_dev *pdev = to_pci_dev(dev->dev);
-#endif
 
-	if (use_vblank){
+	smi_flush_init_work(cdev);
+
+	if (cdev->runpm) {
+		pm_runtime_forbid(dev->dev);
+		pm_runtime_get_noresume(dev->dev);
+		pm_runtime_dont_use_autosuspend(dev->dev);
+		cdev->runpm = false;
+	}
+
+	if (cdev->irq_enabled) {
+		free_irq(cdev->irq, dev);
+		pci_free_irq_vectors(pdev);
+		cdev->irq_enabled = false;
 #if LINUX_VERSION_CODE < KERNEL_VERSION(5, 15, 0)
-	if (dev->irq_enabled)
-		drm_irq_uninstall(dev);
-#else
-	free_irq(pdev->irq, dev);
+		dev->irq_enabled = false;
 #endif
 	}
+	smi_hpd_cancel(cdev);
 
 	/* Disable *all* interrupts */
 	if (cdev->specId == SPC_SM750) {
@@ -237,6 +450,14 @@ void smi_driver_unload(struct drm_device *dev)
 #endif
 
 	kvfree(cdev->regsave);
+	smi_perf_fini(cdev);
+#ifdef SMI_REG_TRACE
+	smi_regtrace_fini();
+#endif
+#ifdef SMI_REG_CACHE
+	smi_regcache_fini(cdev);
+#endif
+	destroy_workqueue(cdev->init_wq);
 	kfree(cdev);
 	dev->dev_private = NULL;
 }
@@ -362,6 +583,14 @@ int smi_device_init(struct smi_device *cdev, struct drm_device *ddev, struct pci
 		return ret;
 	}
 
+	/*
+	 * The SM750 PCI master window takes 32-bit bus addresses. Without
+	 * the buffer smi_vram_read() falls back to memcpy_fromio.
+	 */
+	if (cdev->specId == SPC_SM750 && !dma_set_coherent_mask(&pdev->dev, DMA_BIT_MASK(32)))
+		cdev->readback = dma_alloc_coherent(&pdev->dev, SMI_READBACK_CHUNK,
+						    &cdev->readback_dma, GFP_KERNEL);
+
 	cdev->m_connector = 0;
 
 	return 0;
@@ -369,5 +598,10 @@ int smi_device_init(struct smi_device *cdev, struct drm_device *ddev, struct pci
 
 void smi_device_fini(struct smi_device *cdev)
 {
+	if (cdev->readback) {
+		dma_free_coherent(cdev->dev->dev, SMI_READBACK_CHUNK, cdev->readback,
+				  cdev->readback_dma);
+		cdev->readback = NULL;
+	}
 	smi_vram_fini(cdev);
 }
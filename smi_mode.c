@@ -19,6 +19,7 @@
 #include <drm/drm_plane_helper.h>
 #include <drm/drm_crtc_helper.h>
 #include <drm/drm_probe_helper.h>
+#include <linux/pm_runtime.h>
 
 
 #include "hw750.h"
@@ -27,6 +28,8 @@
 #include "ddk768/ddk768_chip.h"
 #include "hw770.h"
 #include "smi_dbg.h"
+#include "smi_trace.h"
+#include "smi_perf.h"
 #include "ddk770/ddk770_hdmi.h"
 
 #define MAX_COLOR_LUT_ENTRIES 256
@@ -144,21 +147,38 @@ static int count_set_bits(unsigned int value) {
 }
 
 
-static int smi_crtc_set_gamma(struct drm_crtc *crtc, const struct drm_format_info *format,
-			       struct drm_color_lut *lut)
-
+static void smi_crtc_load_gamma(struct drm_crtc *crtc, int dst_ctrl)
 {
+	struct smi_crtc *smi_crtc = to_smi_crtc(crtc);
+	struct smi_device *sdev = crtc->dev->dev_private;
 
-	struct smi_crtc *smi_crtc = to_smi_crtc(crtc); 
+	if(sdev->specId == SPC_SM750) {
+		hw750_setgamma(dst_ctrl, true);
+		hw750_load_lut(dst_ctrl, crtc->gamma_size, smi_crtc->lut_r, smi_crtc->lut_g, smi_crtc->lut_b);
+	}else if (sdev->specId == SPC_SM768) {
+		if(sdev->m_connector & USE_DVI)
+			hw768_setgamma(dst_ctrl, true , lvds_channel);
+		else
+			hw768_setgamma(dst_ctrl, true , 0);
+			
+		hw768_load_lut(dst_ctrl, crtc->gamma_size, smi_crtc->lut_r, smi_crtc->lut_g, smi_crtc->lut_b);
+	}else if (sdev->specId == SPC_SM770) {
+		hw770_setgamma(dst_ctrl, true);
+		hw770_load_lut(dst_ctrl, crtc->gamma_size, smi_crtc->lut_r, smi_crtc->lut_g, smi_crtc->lut_b);
+	}
+}
+
+/* Display controller channel driving this CRTC */
+static int smi_crtc_dst_ctrl(struct drm_crtc *crtc)
+{
 	int i , ctrl_index, dst_ctrl;
 	struct smi_device *sdev = crtc->dev->dev_private;
-	int max_enc, max_ctrl;
+	int max_enc;
 
 	ctrl_index = 0;
 	dst_ctrl = 0;
 
 	max_enc = MAX_ENCODER(sdev->specId);
-	max_ctrl = MAX_CRTC(sdev->specId);	
 
 	for(i = 0;i < max_enc; i++)
 	{
@@ -181,6 +201,21 @@ static int smi_crtc_set_gamma(struct drm_crtc *crtc, const struct drm_format_inf
 	}else if(sdev->specId == SPC_SM770){
 		dst_ctrl = (disp_control_t)smi_encoder_crtc_index_changed(ctrl_index);
 	}
+
+	return dst_ctrl;
+}
+
+/* Without a flip the LUT is loaded right away, else at the flip */
+static int smi_crtc_set_gamma(struct drm_crtc *crtc, const struct drm_format_info *format,
+			       struct drm_color_lut *lut, struct smi_flip *flip)
+
+{
+	unsigned long flags;
+
+	struct smi_crtc *smi_crtc = to_smi_crtc(crtc); 
+	int i, dst_ctrl;
+
+	dst_ctrl = smi_crtc_dst_ctrl(crtc);
 	
 	
 	if(!lut) {
@@ -202,25 +237,115 @@ static int smi_crtc_set_gamma(struct drm_crtc *crtc, const struct drm_format_inf
        	}
        	}
 
-	
-	if(sdev->specId == SPC_SM750) {
-		hw750_setgamma(dst_ctrl, true);
-		hw750_load_lut(dst_ctrl, crtc->gamma_size, smi_crtc->lut_r, smi_crtc->lut_g, smi_crtc->lut_b);
-	}else if (sdev->specId == SPC_SM768) {
-		if(sdev->m_connector & USE_DVI)
-			hw768_setgamma(dst_ctrl, true , lvds_channel);
-		else
-			hw768_setgamma(dst_ctrl, true , 0);
-			
-		hw768_load_lut(dst_ctrl, crtc->gamma_size, smi_crtc->lut_r, smi_crtc->lut_g, smi_crtc->lut_b);
-	}else if (sdev->specId == SPC_SM770) {
-		hw770_setgamma(dst_ctrl, true);
-		hw770_load_lut(dst_ctrl, crtc->gamma_size, smi_crtc->lut_r, smi_crtc->lut_g, smi_crtc->lut_b);
+	if (flip) {
+		spin_lock_irqsave(&flip->lock, flags);
+		flip->lut_ctrl = dst_ctrl;
+		flip->pending |= SMI_FLIP_LUT;
+		spin_unlock_irqrestore(&flip->lock, flags);
+	} else {
+		smi_crtc_load_gamma(crtc, dst_ctrl);
 	}
 	
 	return 0;
 }
 
+/* Record the primary plane base, vbl is the vblank count at the start of the update */
+void smi_flip_set_base(struct drm_crtc *crtc, int ctrl, int pitch, int offset, u64 vbl)
+{
+	struct smi_flip *flip = &to_smi_crtc(crtc)->flip;
+	unsigned long flags;
+
+	spin_lock_irqsave(&flip->lock, flags);
+	flip->base_ctrl = ctrl;
+	flip->base_pitch = pitch;
+	flip->base_offset = offset;
+	flip->vbl = vbl;
+	flip->pending |= SMI_FLIP_BASE;
+	spin_unlock_irqrestore(&flip->lock, flags);
+}
+
+void smi_flip_set_cursor(struct drm_crtc *crtc, int ctrl, unsigned long x, unsigned long y,
+			 unsigned char top, unsigned char left, unsigned int prefetch)
+{
+	struct smi_flip *flip = &to_smi_crtc(crtc)->flip;
+	unsigned long flags;
+
+	spin_lock_irqsave(&flip->lock, flags);
+	flip->cursor_ctrl = ctrl;
+	flip->cursor_x = x;
+	flip->cursor_y = y;
+	flip->cursor_top = top;
+	flip->cursor_left = left;
+	flip->cursor_prefetch = prefetch;
+	flip->pending |= SMI_FLIP_CURSOR;
+	spin_unlock_irqrestore(&flip->lock, flags);
+}
+
+/* Write out the recorded updates in mask, with flip->lock held */
+static void smi_flip_apply(struct drm_crtc *crtc, unsigned int mask)
+{
+	struct smi_device *sdev = crtc->dev->dev_private;
+	struct smi_flip *flip = &to_smi_crtc(crtc)->flip;
+	unsigned int pending = flip->pending & mask;
+	int base_pending = 0;
+
+	if (pending & SMI_FLIP_BASE) {
+		trace_smi_set_base(flip->base_ctrl, flip->base_pitch, flip->base_offset);
+		if (sdev->specId == SPC_SM750)
+			base_pending = hw750_set_base(flip->base_ctrl, flip->base_pitch, flip->base_offset);
+		else if (sdev->specId == SPC_SM768)
+			base_pending = hw768_set_base(flip->base_ctrl, flip->base_pitch, flip->base_offset);
+		else if (sdev->specId == SPC_SM770)
+			base_pending = hw770_set_base(flip->base_ctrl, flip->base_pitch, flip->base_offset);
+
+		/* a vblank went by since the update started, the frame shows one late */
+		if (use_vblank && drm_crtc_vblank_count(crtc) != flip->vbl)
+			smi_perf_inc(sdev, crtc->index, late_flips);
+		if (base_pending)
+			smi_perf_inc(sdev, crtc->index, base_pending);
+	}
+
+	if (pending & SMI_FLIP_CURSOR) {
+		if (sdev->specId == SPC_SM750)
+			ddk750_setCursorPosition(flip->cursor_ctrl, flip->cursor_x, flip->cursor_y,
+						 flip->cursor_top, flip->cursor_left);
+		else if (sdev->specId == SPC_SM768)
+			ddk768_setCursorPosition(flip->cursor_ctrl, flip->cursor_x, flip->cursor_y,
+						 flip->cursor_top, flip->cursor_left);
+		else if (sdev->specId == SPC_SM770)
+			ddk770_setCursorPosition(flip->cursor_ctrl, flip->cursor_x, flip->cursor_y,
+						 flip->cursor_top, flip->cursor_left, flip->cursor_prefetch);
+	}
+
+	if (pending & SMI_FLIP_LUT)
+		smi_crtc_load_gamma(crtc, flip->lut_ctrl);
+
+	flip->pending &= ~mask;
+	if (!flip->pending)
+		flip->armed = false;
+}
+
+/* From smi_irq_handler, before the vblank is handled */
+void smi_flip_irq(struct drm_crtc *crtc)
+{
+	struct smi_flip *flip;
+	bool put;
+
+	if (!crtc)
+		return;
+
+	flip = &to_smi_crtc(crtc)->flip;
+	spin_lock(&flip->lock);
+	if (flip->armed)
+		smi_flip_apply(crtc, ~0U);
+	put = flip->vblank_ref;
+	flip->vblank_ref = false;
+	spin_unlock(&flip->lock);
+
+	if (put)
+		drm_crtc_vblank_put(crtc);
+}
+
 
 static void smi_dp_set_mode(struct smi_device *sdev, dp_index index)
 {
@@ -286,11 +411,12 @@ static void smi_dp_set_mode(struct smi_device *sdev, dp_index index)
  * case and so are just stubs
  */
 
-static void smi_crtc_mode_set_nofb(struct drm_crtc *crtc)
+static void __smi_crtc_mode_set_nofb(struct drm_crtc *crtc)
 {
 	
 	struct drm_display_mode *mode;
 	struct smi_device *sdev = crtc->dev->dev_private;
+	struct smi_crtc *smi_crtc = to_smi_crtc(crtc);
 	logicalMode_t logicalMode;
 	unsigned long refresh_rate;
 	unsigned int need_to_scale = 0;
@@ -304,6 +430,7 @@ static void smi_crtc_mode_set_nofb(struct drm_crtc *crtc)
 	ENTER();
 	
 	logicalMode.valid_edid = false;
+	smi_crtc->fast_set = false;
 
 	if (WARN_ON(!crtc->state))
 		LEAVE();
@@ -365,6 +492,7 @@ static void smi_crtc_mode_set_nofb(struct drm_crtc *crtc)
 	}
 	else if(sdev->specId == SPC_SM768) {  //SPC_SM768
 		int i, ctrl_index, dst_ctrl;
+		bool takeover, restored;
 		ctrl_index = 0;
 		dst_ctrl = 0;
 		for(i = 0;i < MAX_ENCODER(sdev->specId); i++)
@@ -424,6 +552,29 @@ static void smi_crtc_mode_set_nofb(struct drm_crtc *crtc)
 				 logicalMode.y = fixed_height;
 				 logicalMode.valid_edid = false;
 		 }
+
+		/*
+		 * Same timing on the same outputs: the channel keeps running and
+		 * the primary plane update only has to latch the new base/pitch.
+		 * The first modeset on a channel adopted from the VBIOS is treated
+		 * the same, except for HDMI whose TX was reset by HDMI_Init().
+		 * So is the commit replayed by resume when thaw restored the
+		 * channel and no sink changed, HDMI again excepted.
+		 */
+		takeover = sdev->boot_fb[dst_ctrl].bpp && ctrl_index < MAX_CRTC_768;
+		restored = sdev->resuming && !sdev->resume_full && ctrl_index < MAX_CRTC_768;
+		if (!need_to_scale && (!sdev->resuming || restored) &&
+		    (!crtc->state->connectors_changed || takeover || restored) &&
+		    hw768_mode_unchanged(&logicalMode, *mode)) {
+			dbg_msg("DC%d timing unchanged, fast set\n", dst_ctrl);
+			smi_crtc->fast_set = true;
+#ifdef USE_LT8618
+			/* The bridge may have lost power while the chip slept */
+			if (restored && (sdev->m_connector & USE_DVI) && dst_ctrl == 0)
+				hw768_lt8618TaskWork(logicalMode.x, logicalMode.y);
+#endif
+			LEAVE();
+		}
 		
 		hw768_setMode(&logicalMode, *mode);
 		DisableDoublePixel(0);
@@ -556,6 +707,21 @@ static void smi_crtc_mode_set_nofb(struct drm_crtc *crtc)
 		}
 		if(!mode->clock)
 			return;
+
+		/*
+		 * Not when the CRTC is switched back on: disable powered the
+		 * outputs down and DPMS on must retrain the HDMI link. Nor on
+		 * resume: hw770_resume() does not restore the DC registers and
+		 * re-initialises the HDMI and DP PHYs, so every SM770 output
+		 * needs the full modeset (the resume fast path is SM768 only).
+		 */
+		if (!sdev->resuming && !crtc->state->connectors_changed &&
+		    !crtc->state->active_changed &&
+		    hw770_mode_unchanged(&logicalMode, *mode)) {
+			dbg_msg("DC%d timing unchanged, fast set\n", dst_ctrl);
+			smi_crtc->fast_set = true;
+			LEAVE();
+		}
 		
 		hw770_setMode(&logicalMode, *mode);
 		
@@ -602,6 +768,16 @@ static void smi_crtc_mode_set_nofb(struct drm_crtc *crtc)
 	LEAVE();
 }
 
+/* hw_lock keeps encoder init and connector probes off the DDK meanwhile */
+static void smi_crtc_mode_set_nofb(struct drm_crtc *crtc)
+{
+	struct smi_device *sdev = crtc->dev->dev_private;
+
+	mutex_lock(&sdev->hw_lock);
+	__smi_crtc_mode_set_nofb(crtc);
+	mutex_unlock(&sdev->hw_lock);
+}
+
 /* Simple cleanup function */
 static void smi_crtc_destroy(struct drm_crtc *crtc)
 {
@@ -626,6 +802,9 @@ static void smi_crtc_atomic_flush(struct drm_crtc *crtc,
 #else
 	struct drm_crtc_state *crtc_state = old_state;
 #endif
+	struct smi_flip *flip = &to_smi_crtc(crtc)->flip;
+	struct drm_pending_vblank_event *event = crtc->state->event;
+	bool latch, put = false;
 
 	ENTER();
 	/*
@@ -636,14 +815,47 @@ static void smi_crtc_atomic_flush(struct drm_crtc *crtc,
 		if (crtc_state->gamma_lut)
 			smi_crtc_set_gamma(crtc,
 					   NULL,
-					   crtc_state->gamma_lut->data);
+					   crtc_state->gamma_lut->data, flip);
 		else
-			smi_crtc_set_gamma(crtc, NULL, NULL);
+			smi_crtc_set_gamma(crtc, NULL, NULL, flip);
+	}
+
+	trace_smi_crtc_flush(crtc->index, event != NULL);
+
+	/*
+	 * FB_ADDRESS is double buffered and latches the base at the next
+	 * vsync, so it is written now. Cursor and LUT take effect as they are
+	 * written; with vblank interrupts they follow at that vsync, where the
+	 * event completes, so all three land in the same frame.
+	 */
+	latch = use_vblank && crtc_state->active && drm_crtc_vblank_get(crtc) == 0;
+
+	spin_lock_irqsave(&flip->lock, flags);
+	smi_flip_apply(crtc, SMI_FLIP_BASE);
+	if (!latch) {
+		smi_flip_apply(crtc, ~0U);
+		put = flip->vblank_ref;
+		flip->vblank_ref = false;
+	} else {
+		/* an event takes over the reference, else the interrupt drops it */
+		if (!event) {
+			put = flip->vblank_ref;
+			flip->vblank_ref = true;
+		}
+		flip->armed = true;
 	}
+	spin_unlock_irqrestore(&flip->lock, flags);
+
+	if (put)
+		drm_crtc_vblank_put(crtc);
 
 	spin_lock_irqsave(&crtc->dev->event_lock, flags);
-	if (crtc->state->event)
-		drm_crtc_send_vblank_event(crtc, crtc->state->event);
+	if (event) {
+		if (latch)
+			drm_crtc_arm_vblank_event(crtc, event);
+		else
+			drm_crtc_send_vblank_event(crtc, event);
+	}
 	crtc->state->event = NULL;
 	spin_unlock_irqrestore(&crtc->dev->event_lock, flags);
 	LEAVE();
@@ -660,9 +872,9 @@ static void smi_crtc_atomic_enable(struct drm_crtc *crtc,
 	struct smi_device *sdev = crtc->dev->dev_private;
 
 	if (crtc->state->gamma_lut)
-		smi_crtc_set_gamma(crtc, NULL, crtc->state->gamma_lut->data);
+		smi_crtc_set_gamma(crtc, NULL, crtc->state->gamma_lut->data, NULL);
 	else
-		smi_crtc_set_gamma(crtc, NULL, NULL);
+		smi_crtc_set_gamma(crtc, NULL, NULL, NULL);
 
 
 	if (sdev->specId == SPC_SM770){
@@ -684,6 +896,8 @@ static void smi_crtc_atomic_enable(struct drm_crtc *crtc,
 
 	}
 
+	if (use_vblank)
+		drm_crtc_vblank_on(crtc);
 }
 
 static void smi_crtc_atomic_disable(struct drm_crtc *crtc, 
@@ -694,6 +908,21 @@ static void smi_crtc_atomic_disable(struct drm_crtc *crtc,
 #endif
 {
 	struct smi_device *sdev = crtc->dev->dev_private;
+	struct smi_flip *flip = &to_smi_crtc(crtc)->flip;
+	unsigned long flags;
+	bool put;
+
+	/* no more vsync to wait for */
+	spin_lock_irqsave(&flip->lock, flags);
+	smi_flip_apply(crtc, ~0U);
+	put = flip->vblank_ref;
+	flip->vblank_ref = false;
+	spin_unlock_irqrestore(&flip->lock, flags);
+	if (put)
+		drm_crtc_vblank_put(crtc);
+
+	if (use_vblank)
+		drm_crtc_vblank_off(crtc);
 			
 	if (sdev->specId == SPC_SM770){
 
@@ -715,11 +944,50 @@ static void smi_crtc_atomic_disable(struct drm_crtc *crtc,
 	}
 }
 
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 7, 0)
+/*
+ * CURRENT_LINE counts from the first active line, so once it is past
+ * vdisplay the channel is in vblank and vpos goes negative up to the next
+ * frame. There is no horizontal position register, so the timestamp is
+ * good to a line.
+ */
+static bool smi_crtc_get_scanout_position(struct drm_crtc *crtc, bool in_vblank_irq,
+					  int *vpos, int *hpos, ktime_t *stime, ktime_t *etime,
+					  const struct drm_display_mode *mode)
+{
+	struct smi_device *sdev = crtc->dev->dev_private;
+	int dst_ctrl = smi_crtc_dst_ctrl(crtc);
+	int line = 0;
+
+	if (stime)
+		*stime = ktime_get();
+
+	if (sdev->specId == SPC_SM750)
+		line = hw750_get_current_line(dst_ctrl);
+	else if (sdev->specId == SPC_SM768)
+		line = hw768_get_current_line(dst_ctrl);
+	else if (sdev->specId == SPC_SM770)
+		line = hw770_get_current_line(dst_ctrl);
+
+	if (etime)
+		*etime = ktime_get();
+
+	if (line >= mode->crtc_vdisplay)
+		line -= mode->crtc_vtotal;
+
+	*vpos = line;
+	*hpos = 0;
+
+	return true;
+}
+#endif
+
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 5, 0)
 static int smi_enable_vblank(struct drm_crtc *crtc)
 {
 	struct smi_device *sdev = crtc->dev->dev_private;
 
+	smi_perf_vblank_on(sdev, drm_crtc_index(crtc));
 	if (sdev->specId == SPC_SM750) {
 		hw750_en_dis_interrupt(1);
 	} else if (sdev->specId == SPC_SM768) {
@@ -759,13 +1027,19 @@ static const struct drm_crtc_funcs smi_crtc_funcs = {
 	.enable_vblank = smi_enable_vblank,
 	.disable_vblank = smi_disable_vblank,
 #endif
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 7, 0)
+	.get_vblank_timestamp = drm_crtc_vblank_helper_get_vblank_timestamp,
+#endif
 };
 
 static const struct drm_crtc_helper_funcs smi_crtc_helper_funcs = {
 	.mode_set_nofb = smi_crtc_mode_set_nofb,
 	.atomic_flush = smi_crtc_atomic_flush,
 	.atomic_enable = smi_crtc_atomic_enable,
-	.atomic_disable = smi_crtc_atomic_disable
+	.atomic_disable = smi_crtc_atomic_disable,
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 7, 0)
+	.get_scanout_position = smi_crtc_get_scanout_position,
+#endif
 };
 
 
@@ -798,6 +1072,7 @@ static struct smi_crtc *smi_crtc_init(struct drm_device *dev, int crtc_id)
 		}
 	}
 	smi_crtc->CursorOffset = 0;
+	spin_lock_init(&smi_crtc->flip.lock);
 
 	r = drm_crtc_init_with_planes(dev, &smi_crtc->base, primary, cursor, &smi_crtc_funcs, NULL);
 
@@ -896,7 +1171,7 @@ static void smi_encoder_mode_set(struct drm_encoder *encoder,
 {
 }
 
-static void smi_encoder_dpms(struct drm_encoder *encoder, int mode)
+static void __smi_encoder_dpms(struct drm_encoder *encoder, int mode)
 {
 	int index =0, i;
 	struct smi_device *sdev = encoder->dev->dev_private;
@@ -1003,7 +1278,8 @@ static void smi_encoder_dpms(struct drm_encoder *encoder, int mode)
 			dbg_msg("DC %d 770 dpms on\n", index);
 			ddk770_setDisplayDPMS(index, DISP_DPMS_ON);
 			ddk770_swPanelPowerSequence(index, 1, index, 4);
-			if(sdev->is_hdmi[index]){
+			/* The link was not touched by a fast set, no need to retrain it. */
+			if(sdev->is_hdmi[index] && !(encoder->crtc && to_smi_crtc(encoder->crtc)->fast_set)){
 				hdmi_ConnectStatus = ddk770_HDMI_HPD_Detect(index);
 				if((hdmi_ConnectStatus & 0x01) && !(hdmi_ConnectStatus & 0x02)){
 					dbg_msg("dpms reset hdmi%d mode \n", index);
@@ -1016,6 +1292,15 @@ static void smi_encoder_dpms(struct drm_encoder *encoder, int mode)
 	LEAVE();
 }
 
+static void smi_encoder_dpms(struct drm_encoder *encoder, int mode)
+{
+	struct smi_device *sdev = encoder->dev->dev_private;
+
+	mutex_lock(&sdev->hw_lock);
+	__smi_encoder_dpms(encoder, mode);
+	mutex_unlock(&sdev->hw_lock);
+}
+
 static void smi_encoder_prepare(struct drm_encoder *encoder)
 {
 	smi_encoder_dpms(encoder, DRM_MODE_DPMS_OFF);
@@ -1108,6 +1393,34 @@ static struct drm_encoder *smi_encoder_init(struct drm_device *dev, int index)
  	return encoder;
 }
 
+/*
+ * Build the sink ELD from its EDID and keep a copy for the audio driver,
+ * which constrains the PCM to the sink's short audio descriptors.
+ */
+static void smi_connector_update_eld(struct drm_connector *connector,
+				     int sink, struct edid *edid)
+{
+	struct smi_device *sdev = connector->dev->dev_private;
+	unsigned long flags;
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(4, 17, 0)
+	if (edid)
+		drm_edid_to_eld(connector, edid);
+#endif
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 14, 0)
+	mutex_lock(&connector->eld_mutex);
+#endif
+	spin_lock_irqsave(&sdev->eld_lock, flags);
+	if (edid)
+		memcpy(sdev->eld[sink], connector->eld, MAX_ELD_BYTES);
+	else
+		memset(sdev->eld[sink], 0, MAX_ELD_BYTES);
+	spin_unlock_irqrestore(&sdev->eld_lock, flags);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 14, 0)
+	mutex_unlock(&connector->eld_mutex);
+#endif
+}
+
 static int hdmi_get_edid_property(struct drm_connector *connector,
 				  struct edid **hdmi_edid, int use_flag,
 				  hdmi_index index, int retry)
@@ -1139,6 +1452,7 @@ read_again0:
 		count = drm_add_edid_modes(connector, *hdmi_edid);
 		sdev->is_hdmi[index] = drm_detect_hdmi_monitor(*hdmi_edid);
 		ddk770_HDMI_set_SCDC(index, (u8 *)(*hdmi_edid));
+		smi_connector_update_eld(connector, index, *hdmi_edid);
 		dbg_msg("SM770 HDMI_%d connector is %s\n", index,
 			(sdev->is_hdmi[index] ? "HDMI monitor" :
 						"DVI monitor"));
@@ -1148,12 +1462,13 @@ read_again0:
 		count = drm_add_modes_noedid(connector, 3840, 2160);
 		drm_set_preferred_mode(connector, fixed_width, fixed_height);
 		sdev->is_hdmi[index] = true;
+		smi_connector_update_eld(connector, index, NULL);
 	}
 
 	LEAVE(count);
 }
 
-static int smi_connector_get_modes(struct drm_connector *connector)
+static int __smi_connector_get_modes(struct drm_connector *connector)
 {
 
 	int ret __attribute__((unused))= 0;
@@ -1162,6 +1477,7 @@ static int smi_connector_get_modes(struct drm_connector *connector)
 	unsigned int retry = 3;
 	struct smi_device *sdev = connector->dev->dev_private;
 	struct smi_connector *smi_connector = to_smi_connector(connector);
+	u64 start = ktime_get_ns();
 
 	ENTER();
 	dbg_msg("print connector type: [%d], DVI=%d, VGA=%d, HDMI=%d\n",
@@ -1342,10 +1658,13 @@ static int smi_connector_get_modes(struct drm_connector *connector)
 				dbg_msg("DP0 get edid success.\n");
 				drm_connector_update_edid_property(connector, sdev->dp0_edid);
 				count = drm_add_edid_modes(connector, sdev->dp0_edid);
+				smi_connector_update_eld(connector, SMI_AUDIO_SINK_DP(0),
+							 sdev->dp0_edid);
 			}
 
 			if (sdev->dp0_edid == NULL || count == 0)
 			{
+				smi_connector_update_eld(connector, SMI_AUDIO_SINK_DP(0), NULL);
 				drm_connector_update_edid_property(connector, NULL);
 				count = drm_add_modes_noedid(connector, 3840, 2160);
 				drm_set_preferred_mode(connector, fixed_width, fixed_height);
@@ -1367,10 +1686,13 @@ static int smi_connector_get_modes(struct drm_connector *connector)
 				dbg_msg("DP1 get edid success.\n");
 				drm_connector_update_edid_property(connector, sdev->dp1_edid);
 				count = drm_add_edid_modes(connector, sdev->dp1_edid);
+				smi_connector_update_eld(connector, SMI_AUDIO_SINK_DP(1),
+							 sdev->dp1_edid);
 			}
 
 			if (sdev->dp1_edid == NULL || count == 0)
 			{
+				smi_connector_update_eld(connector, SMI_AUDIO_SINK_DP(1), NULL);
 				pr_err("[fail] DP1 get edid fail.\n");
 				drm_connector_update_edid_property(connector, NULL);
 				count = drm_add_modes_noedid(connector, 3840, 2160);
@@ -1397,9 +1719,24 @@ static int smi_connector_get_modes(struct drm_connector *connector)
 						       retry);
 		}
 	}
+	trace_smi_edid_read(connector->name, connector->edid_blob_ptr != NULL,
+			    ktime_get_ns() - start);
 	LEAVE(count);
 }
 
+/* EDID reads go through the DDK software I2C, which init work reprograms */
+static int smi_connector_get_modes(struct drm_connector *connector)
+{
+	struct smi_device *sdev = connector->dev->dev_private;
+	int count;
+
+	mutex_lock(&sdev->hw_lock);
+	count = __smi_connector_get_modes(connector);
+	mutex_unlock(&sdev->hw_lock);
+
+	return count;
+}
+
 #if LINUX_VERSION_CODE < KERNEL_VERSION(6, 15, 0)
 static enum drm_mode_status smi_connector_mode_valid(struct drm_connector *connector,
 													 struct drm_display_mode *mode)
@@ -1480,7 +1817,23 @@ struct drm_encoder *smi_connector_best_encoder(struct drm_connector *connector)
 #endif
 
 
-static enum drm_connector_status smi_connector_detect(struct drm_connector
+/* Whether the encoder behind this connector is still being brought up */
+static bool smi_connector_init_pending(struct smi_device *sdev, struct drm_connector *connector)
+{
+	switch (connector->connector_type) {
+	case DRM_MODE_CONNECTOR_DVII:
+		return test_bit(SMI_INIT_DVI, &sdev->init_pending);
+	case DRM_MODE_CONNECTOR_HDMIA:
+		return test_bit(SMI_INIT_HDMI, &sdev->init_pending);
+	case DRM_MODE_CONNECTOR_DisplayPort:
+	case DRM_MODE_CONNECTOR_eDP:
+		return test_bit(SMI_INIT_DP, &sdev->init_pending);
+	default:
+		return false;
+	}
+}
+
+static enum drm_connector_status __smi_connector_detect(struct drm_connector
 														  *connector,
 													  bool force)
 {
@@ -1492,6 +1845,10 @@ static enum drm_connector_status smi_connector_detect(struct drm_connector
 	void *edid_buf;
 #endif
 
+	/* A hotplug event is sent once the init work is done. */
+	if (smi_connector_init_pending(sdev, connector))
+		return connector_status_disconnected;
+
 	if (sdev->specId == SPC_SM750)
 	{
 		if (connector->connector_type == DRM_MODE_CONNECTOR_DVII)
@@ -1847,6 +2204,19 @@ static enum drm_connector_status smi_connector_detect(struct drm_connector
 	}
 }
 
+static enum drm_connector_status smi_connector_detect(struct drm_connector *connector,
+						      bool force)
+{
+	struct smi_device *sdev = connector->dev->dev_private;
+	enum drm_connector_status status;
+
+	mutex_lock(&sdev->hw_lock);
+	status = __smi_connector_detect(connector, force);
+	mutex_unlock(&sdev->hw_lock);
+
+	return status;
+}
+
 static void smi_connector_destroy(struct drm_connector *connector)
 {
 	struct smi_device *sdev = connector->dev->dev_private;
@@ -1892,10 +2262,28 @@ static const struct drm_connector_helper_funcs smi_vga_connector_helper_funcs =
 #endif
 };
 
+/*
+ * A userspace probe wakes the device, the output poll worker only reads
+ * HPD and EDID, which work with the display clocks gated.
+ */
+static int smi_connector_fill_modes(struct drm_connector *connector,
+				    uint32_t max_x, uint32_t max_y)
+{
+	struct device *dev = connector->dev->dev;
+	int count;
+
+	pm_runtime_get_sync(dev);
+	count = drm_helper_probe_single_connector_modes(connector, max_x, max_y);
+	pm_runtime_mark_last_busy(dev);
+	pm_runtime_put_autosuspend(dev);
+
+	return count;
+}
+
 static const struct drm_connector_funcs smi_vga_connector_funcs = {
 	.dpms = drm_helper_connector_dpms,
 	.detect = smi_connector_detect,
-	.fill_modes = drm_helper_probe_single_connector_modes,
+	.fill_modes = smi_connector_fill_modes,
 	.destroy = smi_connector_destroy,
 	.reset = drm_atomic_helper_connector_reset,
 	.atomic_duplicate_state = drm_atomic_helper_connector_duplicate_state,
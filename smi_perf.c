@@ -0,0 +1,204 @@
+// SPDX-License-Identifier: GPL-2.0+
+// Copyright (c) 2023, SiliconMotion Inc.
+
+#include <linux/debugfs.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+
+#include "smi_drv.h"
+#include "smi_perf.h"
+
+int smi_perf_init(struct smi_device *sdev)
+{
+	struct smi_perf *perf;
+
+	perf = kzalloc(sizeof(*perf), GFP_KERNEL);
+	if (!perf)
+		return -ENOMEM;
+
+	perf->cpu = alloc_percpu(struct smi_perf_cpu);
+	if (!perf->cpu) {
+		kfree(perf);
+		return -ENOMEM;
+	}
+
+	mutex_init(&perf->lock);
+	perf->reset_ns = ktime_get_ns();
+	sdev->perf = perf;
+	return 0;
+}
+
+void smi_perf_fini(struct smi_device *sdev)
+{
+	if (!sdev->perf)
+		return;
+
+	free_percpu(sdev->perf->cpu);
+	kfree(sdev->perf);
+	sdev->perf = NULL;
+}
+
+/* One damage clip copied to VRAM in ns */
+void smi_perf_upload(struct smi_device *sdev, int crtc, u64 bytes, u64 ns)
+{
+	struct smi_perf_crtc __percpu *pc;
+	int bucket;
+
+	if (!sdev->perf)
+		return;
+
+	pc = &sdev->perf->cpu->crtc[crtc];
+	bucket = min_t(int, fls64(div_u64(ns, NSEC_PER_USEC)), SMI_PERF_HIST_BUCKETS - 1);
+
+	this_cpu_inc(pc->uploads);
+	this_cpu_add(pc->damage_bytes, bytes);
+	this_cpu_add(pc->upload_ns, ns);
+	this_cpu_inc(pc->upload_hist[bucket]);
+}
+
+/* Called for every vsync interrupt, counts the frames since the last one */
+void smi_perf_vblank(struct smi_device *sdev, int crtc, u64 framedur_ns)
+{
+	struct smi_perf *perf = sdev->perf;
+	u64 now, last, frames;
+
+	if (!perf)
+		return;
+
+	now = ktime_get_ns();
+	last = READ_ONCE(perf->last_vblank_ns[crtc]);
+	WRITE_ONCE(perf->last_vblank_ns[crtc], now);
+
+	this_cpu_inc(perf->cpu->crtc[crtc].vblanks);
+
+	if (!last || !framedur_ns)
+		return;
+
+	frames = div64_u64(now - last + framedur_ns / 2, framedur_ns);
+	if (frames > 1)
+		this_cpu_add(perf->cpu->crtc[crtc].missed_vblanks, frames - 1);
+}
+
+/* struct smi_perf_crtc is nothing but u64 counters */
+static void smi_perf_sum(struct smi_perf *perf, int crtc, struct smi_perf_crtc *sum)
+{
+	u64 *dst = (u64 *)sum;
+	const u64 *src;
+	int cpu, i;
+
+	memset(sum, 0, sizeof(*sum));
+	for_each_possible_cpu(cpu) {
+		src = (const u64 *)&per_cpu_ptr(perf->cpu, cpu)->crtc[crtc];
+		for (i = 0; i < sizeof(*sum) / sizeof(u64); i++)
+			dst[i] += READ_ONCE(src[i]);
+	}
+}
+
+/* Upper bound in us of the bucket holding the pct percentile */
+static unsigned int smi_perf_percentile(const struct smi_perf_crtc *c, unsigned int pct)
+{
+	u64 target, seen = 0;
+	int i;
+
+	if (!c->uploads)
+		return 0;
+
+	target = div_u64(c->uploads * pct + 99, 100);
+	for (i = 0; i < SMI_PERF_HIST_BUCKETS - 1; i++) {
+		seen += c->upload_hist[i];
+		if (seen >= target)
+			break;
+	}
+	return 1U << i;
+}
+
+static u64 smi_perf_rate(u64 count, u64 elapsed_ms)
+{
+	return div64_u64(count * MSEC_PER_SEC, elapsed_ms ? elapsed_ms : 1);
+}
+
+static int perf_crtc_show(struct seq_file *m, void *unused)
+{
+	struct smi_perf_file *file = m->private;
+	struct smi_perf *perf = file->perf;
+	struct smi_perf_crtc c, *base = &perf->base[file->crtc];
+	u64 *cnt = (u64 *)&c;
+	const u64 *sub = (const u64 *)base;
+	u64 elapsed_ms;
+	int i;
+
+	mutex_lock(&perf->lock);
+	smi_perf_sum(perf, file->crtc, &c);
+	for (i = 0; i < sizeof(c) / sizeof(u64); i++)
+		cnt[i] -= sub[i];
+	elapsed_ms = div_u64(ktime_get_ns() - perf->reset_ns, NSEC_PER_MSEC);
+	mutex_unlock(&perf->lock);
+
+	seq_printf(m, "elapsed_ms: %llu\n", elapsed_ms);
+	seq_printf(m, "commits: %llu\n", c.commits);
+	seq_printf(m, "commits_per_sec: %llu\n", smi_perf_rate(c.commits, elapsed_ms));
+	seq_printf(m, "damage_bytes: %llu\n", c.damage_bytes);
+	seq_printf(m, "damage_bytes_per_sec: %llu\n", smi_perf_rate(c.damage_bytes, elapsed_ms));
+	seq_printf(m, "uploads: %llu\n", c.uploads);
+	seq_printf(m, "upload_avg_us: %llu\n",
+		   c.uploads ? div64_u64(c.upload_ns, c.uploads * NSEC_PER_USEC) : 0);
+	seq_printf(m, "upload_p50_us: %u\n", smi_perf_percentile(&c, 50));
+	seq_printf(m, "upload_p90_us: %u\n", smi_perf_percentile(&c, 90));
+	seq_printf(m, "upload_p99_us: %u\n", smi_perf_percentile(&c, 99));
+	seq_puts(m, "upload_hist_us:");
+	for (i = 0; i < SMI_PERF_HIST_BUCKETS; i++)
+		seq_printf(m, " %u:%llu", i ? 1U << (i - 1) : 0, c.upload_hist[i]);
+	seq_putc(m, '\n');
+	seq_printf(m, "vblanks: %llu\n", c.vblanks);
+	seq_printf(m, "missed_vblanks: %llu\n", c.missed_vblanks);
+	seq_printf(m, "late_flips: %llu\n", c.late_flips);
+	seq_printf(m, "base_pending: %llu\n", c.base_pending);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(perf_crtc);
+
+/* Any write restarts all the CRTCs from zero */
+static ssize_t perf_reset_write(struct file *file, const char __user *user_data,
+				size_t cnt, loff_t *lt)
+{
+	struct smi_perf *perf = file->private_data;
+	int i;
+
+	mutex_lock(&perf->lock);
+	for (i = 0; i < MAX_CRTC_770; i++)
+		smi_perf_sum(perf, i, &perf->base[i]);
+	perf->reset_ns = ktime_get_ns();
+	mutex_unlock(&perf->lock);
+
+	return cnt;
+}
+
+static const struct file_operations perf_reset_fops = {
+	.owner = THIS_MODULE,
+	.open  = simple_open,
+	.write = perf_reset_write,
+};
+
+void smi_perf_debugfs_init(struct smi_device *sdev, struct dentry *root)
+{
+	struct dentry *dir;
+	char name[8];
+	int i;
+
+	if (!sdev->perf)
+		return;
+
+	dir = debugfs_create_dir("perf", root);
+
+	for (i = 0; i < sdev->dev->mode_config.num_crtc && i < MAX_CRTC_770; i++) {
+		sdev->perf->files[i].perf = sdev->perf;
+		sdev->perf->files[i].crtc = i;
+		snprintf(name, sizeof(name), "crtc%d", i);
+		debugfs_create_file(name, 0444, dir, &sdev->perf->files[i], &perf_crtc_fops);
+	}
+
+	debugfs_create_file("reset", 0200, dir, sdev->perf, &perf_reset_fops);
+}
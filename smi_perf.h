@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: GPL-2.0+
+// Copyright (c) 2023, SiliconMotion Inc.
+
+#ifndef __SMI_PERF_H__
+#define __SMI_PERF_H__
+
+#include <linux/mutex.h>
+#include <linux/percpu.h>
+#include <linux/types.h>
+
+/*
+ * Display pipeline counters, one set per CRTC, read from debugfs perf/.
+ * The hot paths only do this_cpu_* updates; debugfs sums the CPUs.
+ * Include after smi_drv.h.
+ */
+
+/* Upload latency, bucket 0 is < 1us and bucket n is [2^(n-1), 2^n) us */
+#define SMI_PERF_HIST_BUCKETS	16
+
+struct smi_perf_crtc {
+	u64 commits;		/* primary plane updates */
+	u64 damage_bytes;	/* bytes copied to VRAM */
+	u64 uploads;		/* damage clips copied */
+	u64 upload_ns;
+	u64 upload_hist[SMI_PERF_HIST_BUCKETS];
+	u64 vblanks;
+	u64 missed_vblanks;	/* vsync interrupts that never arrived */
+	u64 late_flips;		/* commits that crossed a vblank before set_base */
+	u64 base_pending;	/* set_base while the last base was not latched */
+};
+
+struct smi_perf_cpu {
+	struct smi_perf_crtc crtc[MAX_CRTC_770];
+};
+
+struct smi_perf_file {
+	struct smi_perf *perf;
+	int crtc;
+};
+
+struct smi_perf {
+	struct smi_perf_cpu __percpu *cpu;
+	struct mutex lock;	/* reset against the debugfs readers */
+	struct smi_perf_crtc base[MAX_CRTC_770];	/* totals at the last reset */
+	u64 reset_ns;
+	u64 last_vblank_ns[MAX_CRTC_770];	/* last vsync seen by smi_irq_handler */
+	struct smi_perf_file files[MAX_CRTC_770];	/* debugfs perf/crtcN */
+};
+
+struct dentry;
+
+int smi_perf_init(struct smi_device *sdev);
+void smi_perf_fini(struct smi_device *sdev);
+void smi_perf_debugfs_init(struct smi_device *sdev, struct dentry *root);
+void smi_perf_upload(struct smi_device *sdev, int crtc, u64 bytes, u64 ns);
+void smi_perf_vblank(struct smi_device *sdev, int crtc, u64 framedur_ns);
+
+#define smi_perf_inc(sdev, idx, field)					\
+	do {								\
+		if ((sdev)->perf)					\
+			this_cpu_inc((sdev)->perf->cpu->crtc[idx].field);	\
+	} while (0)
+
+/* vsync was masked, the next interrupt does not mean missed frames */
+static inline void smi_perf_vblank_on(struct smi_device *sdev, int crtc)
+{
+	if (sdev->perf)
+		WRITE_ONCE(sdev->perf->last_vblank_ns[crtc], 0);
+}
+
+#endif
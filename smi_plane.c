@@ -37,6 +37,8 @@
 #endif
 
 #include "smi_dbg.h"
+#include "smi_trace.h"
+#include "smi_perf.h"
 
 #include "hw750.h"
 #include "hw768.h"
@@ -189,6 +191,8 @@ static void smi_cursor_atomic_update(struct drm_plane *plane, struct drm_plane_s
 	drm_gem_shmem_vunmap(fb->obj[0],src);
 #endif
 	if (fb_changed) {
+	smi_vram_track(sdev, disp_ctrl, SMI_VRAM_CURSOR, dst_off,
+		       4 * CURSOR_WIDTH * (CURSOR_HEIGHT + 4), true);
 	if (sdev->specId == SPC_SM750) {
 			ddk750_initCursor(disp_ctrl, (u32)dst_off, BPP16_BLACK,
 				BPP16_WHITE, BPP16_BLUE);
@@ -211,24 +215,21 @@ static void smi_cursor_atomic_update(struct drm_plane *plane, struct drm_plane_s
 	y = plane_state->crtc_y;
 
 
-	/* set cursor location */
-	if (sdev->specId == SPC_SM750) {
-		ddk750_setCursorPosition(disp_ctrl, x < 0 ? -x : x, y < 0 ? -y : y, y < 0 ? 1 : 0,
-					 x < 0 ? 1 : 0);
-	} else if (sdev->specId == SPC_SM768) {
-		ddk768_setCursorPosition(disp_ctrl, x < 0 ? -x : x, y < 0 ? -y : y, y < 0 ? 1 : 0,
-					 x < 0 ? 1 : 0);
+	/* set cursor location, written at the flip with the primary plane */
+	if (sdev->specId == SPC_SM750 || sdev->specId == SPC_SM768) {
+		smi_flip_set_cursor(crtc, disp_ctrl, x < 0 ? -x : x, y < 0 ? -y : y,
+				    y < 0 ? 1 : 0, x < 0 ? 1 : 0, 0);
 	} else if (sdev->specId == SPC_SM770) {
 		width = hw770_get_current_mode_width(disp_ctrl);
 		if((x + CURSOR_WIDTH) >= width){
-			ddk770_setCursorPosition(disp_ctrl, x < 0 ? -x : x, y < 0 ? -y : y, y < 0 ? 1 : 0,
-					 x < 0 ? 1 : 0, 0);
+			smi_flip_set_cursor(crtc, disp_ctrl, x < 0 ? -x : x, y < 0 ? -y : y,
+					    y < 0 ? 1 : 0, x < 0 ? 1 : 0, 0);
 		} else {
 			if (x == -CURSOR_WIDTH) {
 				return;
 			}
-			ddk770_setCursorPosition(disp_ctrl, x < 0 ? -x : x, y < 0 ? -y : y, y < 0 ? 1 : 0,
-					 x < 0 ? 1 : 0, 1);
+			smi_flip_set_cursor(crtc, disp_ctrl, x < 0 ? -x : x, y < 0 ? -y : y,
+					    y < 0 ? 1 : 0, x < 0 ? 1 : 0, 1);
 		}
 		//printk("current cursor position dc:%d x:%d  y:%d  width:%d\n",disp_ctrl,x,y,width);
 	}
@@ -275,7 +276,9 @@ static void smi_cursor_atomic_disable(struct drm_plane *plane,
 		disp_ctrl = (disp_control_t)smi_encoder_crtc_index_changed(ctrl_index);
 	}
 
-		
+
+	smi_vram_track(sdev, disp_ctrl, SMI_VRAM_CURSOR, 0, 0, true);
+
 	if (sdev->specId == SPC_SM750) {
 		ddk750_enableCursor(disp_ctrl, 0);
 	} else if(sdev->specId == SPC_SM768) {
@@ -328,6 +331,7 @@ static void smi_handle_damage(struct smi_plane *smi_plane, struct drm_plane_stat
 {
 	void *back_buffer;
 	struct drm_crtc* crtc = plane_state->crtc;
+	struct smi_device *sdev = crtc->dev->dev_private;
 	unsigned int plane_visbleX = (plane_state->src_x >> 16);
 	unsigned int plane_visbleY = (plane_state->src_y >> 16);
 	unsigned int clip_offset;
@@ -336,6 +340,11 @@ static void smi_handle_damage(struct smi_plane *smi_plane, struct drm_plane_stat
 	};
 	unsigned int width = crtc->state->adjusted_mode.hdisplay;
 	unsigned int mode_pitch = alignLineOffset(width * fb->format->cpp[0]);
+	unsigned int bytes = drm_rect_width(clip) * drm_rect_height(clip) * fb->format->cpp[0];
+	/* the clock is only read for the perf counters or the tracepoint */
+	bool timed = sdev->perf || trace_smi_damage_enabled();
+	u64 start = timed ? ktime_get_ns() : 0;
+
 	clip_offset =  (clip->x1 - plane_visbleX) * fb->format->cpp[0] + (clip->y1 - plane_visbleY) * mode_pitch;
 	dst_pitch[0] = mode_pitch;
 	if(use_doublebuffer)
@@ -399,6 +408,82 @@ static void smi_handle_damage(struct smi_plane *smi_plane, struct drm_plane_stat
 	drm_gem_shmem_vunmap(fb->obj[0], vmap);
 	
 #endif
+	if (!timed)
+		return;
+	start = ktime_get_ns() - start;
+	smi_perf_upload(sdev, crtc->index, bytes, start);
+	trace_smi_damage(crtc->index, clip->x1, clip->y1, clip->x2, clip->y2, bytes, start);
+}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 1, 0)
+/*
+ * Seed the fbdev shadow buffer with the image the VBIOS left on screen, so
+ * the first upload rewrites the same pixels instead of blanking them.
+ */
+static void smi_plane_copy_boot_fb(struct smi_device *sdev, struct smi_boot_fb *boot_fb,
+				   struct drm_plane_state *plane_state, struct iosys_map *map)
+{
+	struct drm_framebuffer *fb = plane_state->fb;
+	struct drm_fb_helper *fb_helper = sdev->dev->fb_helper;
+	unsigned int y, len;
+
+	if (!fb_helper || fb_helper->fb != fb || map->is_iomem)
+		return;
+
+	len = boot_fb->x * fb->format->cpp[0];
+	if (fb->format->cpp[0] * 8 != boot_fb->bpp || fb->width != boot_fb->x ||
+	    fb->height != boot_fb->y || plane_state->src_x || plane_state->src_y ||
+	    boot_fb->pitch < len || boot_fb->base + boot_fb->pitch * boot_fb->y > sdev->vram_size)
+		return;
+
+	dbg_msg("copy boot fb %ux%u from 0x%x\n", boot_fb->x, boot_fb->y, boot_fb->base);
+	for (y = 0; y < boot_fb->y; y++)
+		memcpy_fromio(map->vaddr + y * fb->pitches[0],
+			      sdev->vram + boot_fb->base + y * boot_fb->pitch, len);
+}
+#endif
+
+/* VRAM offset of the scanout area owned by each display controller */
+static unsigned int smi_plane_dc_offset(int specId, int disp_ctrl)
+{
+	if (disp_ctrl == 1) {
+		if (specId == SPC_SM768)
+			return SM768_MAX_MODE_SIZE;
+		if (specId == SPC_SM750)
+			return SM750_MAX_MODE_SIZE;
+		if (specId == SPC_SM770)
+			return sm770_max_mode_size;
+	} else if (disp_ctrl == 2 && specId == SPC_SM770) {
+		return sm770_max_mode_size << 1;
+	}
+	return 0; /* with shmem, the primary plane is always at offset 0 */
+}
+
+/* front and back buffer split the DC area in two */
+static unsigned int smi_plane_buffer_size(int specId)
+{
+	if (specId == SPC_SM768)
+		return SM768_MAX_MODE_SIZE / 2;
+	if (specId == SPC_SM750)
+		return SM750_MAX_MODE_SIZE / 2;
+	if (specId == SPC_SM770)
+		return sm770_max_mode_size / 2;
+	return 0;
+}
+
+/* SM770 needs a 256 byte aligned start address when panning */
+static int smi_plane_line_align(int specId, int x, unsigned int cpp)
+{
+	if (specId == SPC_SM770 && (x % 0x100))
+		return alignLineOffset(x * cpp) - x * cpp;
+	return 0;
+}
+
+static int smi_plane_scanout_offset(unsigned int dst_off, int current_buffer,
+				    unsigned int buffer_size, unsigned int pitch,
+				    unsigned int cpp, int x, int y, int align)
+{
+	return dst_off + current_buffer * buffer_size + y * ALIGN(pitch, 16) + x * cpp + align;
 }
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 13, 0)
@@ -428,6 +513,7 @@ static void smi_primary_plane_atomic_update(struct drm_plane *plane, struct drm_
 	int i, ctrl_index = 0, max_enc = 0;
 	disp_control_t disp_ctrl;
 	int pitch_align = 0;
+	u64 vbl = 0;
 	struct smi_device *sdev = plane->dev->dev_private;	
 
 	if (!plane_state->crtc || !plane_state->fb)
@@ -438,6 +524,10 @@ static void smi_primary_plane_atomic_update(struct drm_plane *plane, struct drm_
 
 	crtc = plane_state->crtc;
 
+	smi_perf_inc(sdev, crtc->index, commits);
+	if (use_vblank)
+		vbl = drm_crtc_vblank_count(crtc);
+
 	max_enc = MAX_ENCODER(sdev->specId);
 
 	for(i = 0;i < max_enc; i++)
@@ -461,43 +551,28 @@ static void smi_primary_plane_atomic_update(struct drm_plane *plane, struct drm_
 
 	x = (plane_state->src_x >> 16);
 	y = (plane_state->src_y >> 16);
+	trace_smi_plane_update(disp_ctrl, fb->base.id, x, y);
 	//printk("before smi_handle_damage dc%d x:%d  y:%d\n",disp_ctrl,x,y);
 	/* primary plane offset */
-	if(disp_ctrl == 0) 
-		dst_off = 0;  /* with shmem, the primary plane is always at offset 0 */
-	if(disp_ctrl == 1) {
-		if (sdev->specId == SPC_SM768) 
-				dst_off = SM768_MAX_MODE_SIZE; //the second DC is at offset 32MB
-		else if (sdev->specId == SPC_SM750) 
-				dst_off = SM750_MAX_MODE_SIZE; //the second DC is at offset 8MB	
-		else if (sdev->specId == SPC_SM770) 
-				dst_off = sm770_max_mode_size; 
-	}if(disp_ctrl == 2)
-	{
-		if (sdev->specId == SPC_SM770) 
-		dst_off = sm770_max_mode_size<<1;         //the third DC is at offset 64MB
-	}
+	dst_off = smi_plane_dc_offset(sdev->specId, disp_ctrl);
+	smi_plane->align = smi_plane_line_align(sdev->specId, x, fb->format->cpp[0]);
 
-	if (sdev->specId == SPC_SM770 && (x % 0x100))
-		smi_plane->align = alignLineOffset(x * fb->format->cpp[0]) - x * fb->format->cpp[0];
-	else 
-		smi_plane->align = 0;
-	
 	if (use_doublebuffer)
-	{
-
-		if (sdev->specId == SPC_SM768)
-			buffer_size = SM768_MAX_MODE_SIZE / 2; // the second DC is at offset 32MB
-		else if (sdev->specId == SPC_SM750)
-			buffer_size = SM750_MAX_MODE_SIZE / 2; // the second DC is at offset 8MB
-		else if (sdev->specId == SPC_SM770)
-			buffer_size = sm770_max_mode_size / 2;
-
-	}
+		buffer_size = smi_plane_buffer_size(sdev->specId);
 	else
 		smi_plane->vaddr = (smi_plane->vaddr_base + dst_off);
 		//smi_plane->vaddr = (smi_plane->vaddr_base + dst_off + smi_plane->align);
 	//printk("smi_primary_plane_atomic_update(): disp_ctrl %d,  vram_size %x, dst_off %x  pitch %d  smi_plane->vaddr_base:%p\n", disp_ctrl,  smi_plane->vram_size, dst_off,fb->pitches[0],smi_plane->vaddr_base);
+
+	/* The VBIOS image is only worth keeping for the first frame. */
+	if (sdev->boot_fb[disp_ctrl].bpp) {
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 1, 0)
+		smi_plane_copy_boot_fb(sdev, &sdev->boot_fb[disp_ctrl], plane_state,
+				       &shadow_plane_state->data[0]);
+#endif
+		sdev->boot_fb[disp_ctrl].bpp = 0;
+		smi_vram_track(sdev, disp_ctrl, SMI_VRAM_BOOT, 0, 0, false);
+	}
 	
 	drm_atomic_helper_damage_iter_init(&iter, old_plane_state, plane_state);
 	drm_atomic_for_each_plane_damage(&iter, &damage) {
@@ -520,21 +595,18 @@ static void smi_primary_plane_atomic_update(struct drm_plane *plane, struct drm_
 	y = (plane_state->src_y >> 16);
 	
 	if (use_doublebuffer)
-		offset = dst_off + smi_plane->current_buffer * buffer_size + y * ALIGN(fb->pitches[0], 16) +
-			 x * fb->format->cpp[0] + smi_plane->align;
+		offset = smi_plane_scanout_offset(dst_off, smi_plane->current_buffer, buffer_size,
+						  fb->pitches[0], fb->format->cpp[0], x, y, smi_plane->align);
 	else
 	   offset = dst_off;
 	//offset = dst_off + y * fb->pitches[0] + x * fb->format->cpp[0] + smi_plane->align;
 
 	//printk("DC%d set_base: offset %x, distoffset %x, pitch %d, x %d, y %d  align %d\n", disp_ctrl,offset,dst_off, fb->pitches[0], x, y,smi_plane->align);
-	if (sdev->specId == SPC_SM750) {
-		hw750_set_base(disp_ctrl, pitch_align, offset);
-	} else if (sdev->specId == SPC_SM768) {
-		hw768_set_base(disp_ctrl, pitch_align, offset);
-	} else if (sdev->specId == SPC_SM770) {
-		//hw770_set_base(disp_ctrl, fb->pitches[0], offset);
-		hw770_set_base(disp_ctrl, pitch_align, offset);
-	}
+	smi_vram_track(sdev, disp_ctrl, SMI_VRAM_PRIMARY, dst_off,
+		       buffer_size + pitch_align * crtc->state->adjusted_mode.vdisplay, true);
+
+	/* written by smi_crtc_atomic_flush() together with cursor and LUT */
+	smi_flip_set_base(crtc, disp_ctrl, pitch_align, offset, vbl);
 
 	if (use_doublebuffer) {
 	    // Swap buffers with synchronization
@@ -567,6 +639,7 @@ static int smi_primary_plane_atomic_check(struct drm_plane *plane,
 #endif
 	struct drm_crtc *crtc = state->crtc;
 	struct drm_crtc_state *crtc_state;
+	int ret;
 
 	ENTER();
 
@@ -581,12 +654,14 @@ static int smi_primary_plane_atomic_check(struct drm_plane *plane,
 	if (IS_ERR(crtc_state))
 		LEAVE(PTR_ERR(crtc_state));
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 1, 0)
-	LEAVE(drm_atomic_helper_check_plane_state(state, crtc_state, DRM_PLANE_NO_SCALING,
-						  DRM_PLANE_NO_SCALING, false, true));
+	ret = drm_atomic_helper_check_plane_state(state, crtc_state, DRM_PLANE_NO_SCALING,
+						  DRM_PLANE_NO_SCALING, false, true);
 #else
-	LEAVE(drm_atomic_helper_check_plane_state(state, crtc_state, DRM_PLANE_HELPER_NO_SCALING,
-						  DRM_PLANE_HELPER_NO_SCALING, false, true));
+	ret = drm_atomic_helper_check_plane_state(state, crtc_state, DRM_PLANE_HELPER_NO_SCALING,
+						  DRM_PLANE_HELPER_NO_SCALING, false, true);
 #endif
+	trace_smi_plane_check(plane->base.id, crtc->index, ret);
+	LEAVE(ret);
 }
 
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 13, 0)
@@ -733,3 +808,7 @@ __attribute__((unused)) static void colorcur2monocur(void *data)
 		}
 	}
 }
+
+#ifdef SMI_KUNIT
+#include "smi_plane_test.c"
+#endif
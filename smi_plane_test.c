@@ -0,0 +1,375 @@
+// SPDX-License-Identifier: GPL-2.0+
+// Copyright (c) 2023, SiliconMotion Inc.
+
+/*
+ * KUnit tests for the primary plane pitch/offset math and the damage upload.
+ * Built into smi_plane.c with "make kunit=1" so the static helpers are
+ * reachable; VRAM is a plain kernel buffer, no hardware is touched.
+ */
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 1, 0)
+
+#include <kunit/test.h>
+#include <linux/vmalloc.h>
+
+/* a full frame upload slower than this is a regression, not noise */
+#define SMI_TEST_MIN_MBPS	100
+#define SMI_TEST_FILL		0xa5
+
+static void smi_test_align_line_offset(struct kunit *test)
+{
+	unsigned int x;
+
+	KUNIT_EXPECT_EQ(test, alignLineOffset(0), 0);
+	KUNIT_EXPECT_EQ(test, alignLineOffset(1), 256);
+	KUNIT_EXPECT_EQ(test, alignLineOffset(256), 256);
+	KUNIT_EXPECT_EQ(test, alignLineOffset(257), 512);
+	KUNIT_EXPECT_EQ(test, alignLineOffset(1366 * 4), 5632);
+	KUNIT_EXPECT_EQ(test, alignLineOffset(1920 * 4), 7680);
+	KUNIT_EXPECT_EQ(test, alignLineOffset(0xff00), 0xff00);
+	/* no room to round up, the value is passed through */
+	KUNIT_EXPECT_EQ(test, alignLineOffset(0xff01), 0xff01);
+	KUNIT_EXPECT_EQ(test, alignLineOffset(0xffff), 0xffff);
+
+	for (x = 1; x <= 0xff00; x++) {
+		unsigned int pitch = alignLineOffset(x);
+
+		KUNIT_ASSERT_EQ_MSG(test, pitch % 256, 0, "x=%u", x);
+		KUNIT_ASSERT_GE_MSG(test, pitch, x, "x=%u", x);
+		KUNIT_ASSERT_LT_MSG(test, pitch, x + 256, "x=%u", x);
+	}
+}
+
+static void smi_test_dc_offset(struct kunit *test)
+{
+	int dc;
+
+	KUNIT_EXPECT_EQ(test, smi_plane_dc_offset(SPC_SM750, 0), 0);
+	KUNIT_EXPECT_EQ(test, smi_plane_dc_offset(SPC_SM750, 1), SM750_MAX_MODE_SIZE);
+	KUNIT_EXPECT_EQ(test, smi_plane_dc_offset(SPC_SM768, 0), 0);
+	KUNIT_EXPECT_EQ(test, smi_plane_dc_offset(SPC_SM768, 1), SM768_MAX_MODE_SIZE);
+	KUNIT_EXPECT_EQ(test, smi_plane_dc_offset(SPC_SM770, 0), 0);
+	KUNIT_EXPECT_EQ(test, smi_plane_dc_offset(SPC_SM770, 1), sm770_max_mode_size);
+	KUNIT_EXPECT_EQ(test, smi_plane_dc_offset(SPC_SM770, 2), sm770_max_mode_size << 1);
+	/* SM750 and SM768 only have two DCs */
+	KUNIT_EXPECT_EQ(test, smi_plane_dc_offset(SPC_SM750, 2), 0);
+	KUNIT_EXPECT_EQ(test, smi_plane_dc_offset(SPC_SM768, 2), 0);
+
+	KUNIT_EXPECT_EQ(test, smi_plane_buffer_size(SPC_SM750), SM750_MAX_MODE_SIZE / 2);
+	KUNIT_EXPECT_EQ(test, smi_plane_buffer_size(SPC_SM768), SM768_MAX_MODE_SIZE / 2);
+	KUNIT_EXPECT_EQ(test, smi_plane_buffer_size(SPC_SM770), sm770_max_mode_size / 2);
+
+	/* both buffers of a DC end where the next DC starts */
+	for (dc = 0; dc < 2; dc++)
+		KUNIT_EXPECT_LE(test, smi_plane_dc_offset(SPC_SM770, dc) +
+				2 * smi_plane_buffer_size(SPC_SM770),
+				smi_plane_dc_offset(SPC_SM770, dc + 1));
+	KUNIT_EXPECT_LE(test, 2 * smi_plane_buffer_size(SPC_SM768),
+			smi_plane_dc_offset(SPC_SM768, 1));
+	KUNIT_EXPECT_LE(test, 2 * smi_plane_buffer_size(SPC_SM750),
+			smi_plane_dc_offset(SPC_SM750, 1));
+}
+
+static void smi_test_line_align(struct kunit *test)
+{
+	unsigned int cpp;
+	int x;
+
+	KUNIT_EXPECT_EQ(test, smi_plane_line_align(SPC_SM770, 0, 4), 0);
+	KUNIT_EXPECT_EQ(test, smi_plane_line_align(SPC_SM770, 64, 4), 0);
+	KUNIT_EXPECT_EQ(test, smi_plane_line_align(SPC_SM770, 65, 4), 252);
+	KUNIT_EXPECT_EQ(test, smi_plane_line_align(SPC_SM770, 1, 2), 254);
+	KUNIT_EXPECT_EQ(test, smi_plane_line_align(SPC_SM768, 65, 4), 0);
+	KUNIT_EXPECT_EQ(test, smi_plane_line_align(SPC_SM750, 65, 4), 0);
+
+	/* the panned start must land on a 256 byte boundary */
+	for (cpp = 2; cpp <= 4; cpp += 2) {
+		for (x = 0; x * cpp <= 0xff00; x++) {
+			int align = smi_plane_line_align(SPC_SM770, x, cpp);
+
+			KUNIT_ASSERT_EQ_MSG(test, (x * cpp + align) % 256, 0, "x=%d cpp=%u", x, cpp);
+			KUNIT_ASSERT_LT_MSG(test, align, 256, "x=%d cpp=%u", x, cpp);
+		}
+	}
+}
+
+static void smi_test_scanout_offset(struct kunit *test)
+{
+	unsigned int dst_off = smi_plane_dc_offset(SPC_SM768, 1);
+	unsigned int size = smi_plane_buffer_size(SPC_SM768);
+
+	KUNIT_EXPECT_EQ(test, smi_plane_scanout_offset(dst_off, 0, size, 1920 * 4, 4, 0, 0, 0),
+			dst_off);
+	KUNIT_EXPECT_EQ(test, smi_plane_scanout_offset(dst_off, 1, size, 1920 * 4, 4, 0, 0, 0),
+			dst_off + size);
+	/* 1366 * 4 is not a multiple of 16, the line step is rounded up */
+	KUNIT_EXPECT_EQ(test, smi_plane_scanout_offset(0, 0, size, 1366 * 4, 4, 0, 1, 0), 5472);
+	KUNIT_EXPECT_EQ(test, smi_plane_scanout_offset(0, 1, size, 1366 * 4, 4, 10, 3, 0),
+			size + 3 * 5472 + 40);
+	KUNIT_EXPECT_EQ(test, smi_plane_scanout_offset(0, 0, size, 1920 * 2, 2, 65, 0,
+						       smi_plane_line_align(SPC_SM770, 65, 2)),
+			256);
+}
+
+struct smi_damage_ctx {
+	struct drm_device drm;
+	struct smi_device sdev;
+	struct drm_crtc crtc;
+	struct drm_crtc_state crtc_state;
+	struct drm_plane_state state;
+	struct drm_framebuffer fb;
+	struct smi_plane plane;
+	struct iosys_map src[DRM_FORMAT_MAX_PLANES];
+	u8 *shadow;
+	u8 *vram[2];
+	u8 *expect;
+	size_t vram_size;
+	unsigned int mode_pitch;
+	int saved_doublebuffer;
+	u32 seed;
+};
+
+static u32 smi_test_rand(struct smi_damage_ctx *ctx)
+{
+	/* xorshift32, fixed seed so failures reproduce */
+	ctx->seed ^= ctx->seed << 13;
+	ctx->seed ^= ctx->seed >> 17;
+	ctx->seed ^= ctx->seed << 5;
+	return ctx->seed;
+}
+
+static void smi_damage_setup(struct kunit *test, u32 format, unsigned int fb_w, unsigned int fb_h,
+			     unsigned int hdisplay, unsigned int vdisplay,
+			     unsigned int src_x, unsigned int src_y)
+{
+	struct smi_damage_ctx *ctx = test->priv;
+	unsigned int cpp, i;
+	size_t shadow_size;
+
+	ctx->drm.dev_private = &ctx->sdev;
+	ctx->crtc.dev = &ctx->drm;
+	ctx->crtc.index = 0;
+	ctx->crtc.state = &ctx->crtc_state;
+	ctx->crtc_state.adjusted_mode.hdisplay = hdisplay;
+	ctx->crtc_state.adjusted_mode.vdisplay = vdisplay;
+
+	ctx->fb.format = drm_format_info(format);
+	KUNIT_ASSERT_NOT_NULL(test, ctx->fb.format);
+	cpp = ctx->fb.format->cpp[0];
+	ctx->fb.width = fb_w;
+	ctx->fb.height = fb_h;
+	/* padded stride, so source and destination pitches differ */
+	ctx->fb.pitches[0] = fb_w * cpp + 64;
+
+	ctx->state.crtc = &ctx->crtc;
+	ctx->state.fb = &ctx->fb;
+	ctx->state.src_x = src_x << 16;
+	ctx->state.src_y = src_y << 16;
+
+	shadow_size = ctx->fb.pitches[0] * fb_h;
+	ctx->shadow = kvmalloc(shadow_size, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, ctx->shadow);
+	for (i = 0; i < shadow_size; i++)
+		ctx->shadow[i] = smi_test_rand(ctx);
+	iosys_map_set_vaddr(&ctx->src[0], ctx->shadow);
+
+	ctx->mode_pitch = alignLineOffset(hdisplay * cpp);
+	/* room for the SM770 panning alignment in front of the frame */
+	ctx->vram_size = ctx->mode_pitch * vdisplay + 256;
+	for (i = 0; i < 2; i++) {
+		ctx->vram[i] = kvmalloc(ctx->vram_size, GFP_KERNEL);
+		KUNIT_ASSERT_NOT_NULL(test, ctx->vram[i]);
+		memset(ctx->vram[i], SMI_TEST_FILL, ctx->vram_size);
+	}
+	ctx->expect = kvmalloc(ctx->vram_size, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, ctx->expect);
+	memset(ctx->expect, SMI_TEST_FILL, ctx->vram_size);
+
+	ctx->plane.vaddr = (void __iomem *)ctx->vram[0];
+	ctx->plane.vaddr_front = (void __iomem *)ctx->vram[0];
+	ctx->plane.vaddr_back = (void __iomem *)ctx->vram[1];
+}
+
+/* reference blit: one memcpy per line into the visible window */
+static void smi_damage_expect(struct smi_damage_ctx *ctx, const struct drm_rect *clip, int align)
+{
+	unsigned int cpp = ctx->fb.format->cpp[0];
+	unsigned int sx = ctx->state.src_x >> 16, sy = ctx->state.src_y >> 16;
+	int y;
+
+	for (y = clip->y1; y < clip->y2; y++)
+		memcpy(ctx->expect + align + (y - sy) * ctx->mode_pitch + (clip->x1 - sx) * cpp,
+		       ctx->shadow + y * ctx->fb.pitches[0] + clip->x1 * cpp,
+		       drm_rect_width(clip) * cpp);
+}
+
+static void smi_damage_check(struct kunit *test, const u8 *vram, const struct drm_rect *clip)
+{
+	struct smi_damage_ctx *ctx = test->priv;
+	size_t i;
+
+	for (i = 0; i < ctx->vram_size; i++)
+		if (vram[i] != ctx->expect[i])
+			break;
+	KUNIT_EXPECT_EQ_MSG(test, i, ctx->vram_size,
+			    "clip " DRM_RECT_FMT ": byte %zu is %02x, expected %02x", DRM_RECT_ARG(clip),
+			    i, i < ctx->vram_size ? vram[i] : 0, i < ctx->vram_size ? ctx->expect[i] : 0);
+}
+
+static void smi_damage_upload(struct kunit *test, struct drm_rect *clip, int align)
+{
+	struct smi_damage_ctx *ctx = test->priv;
+
+	smi_handle_damage(&ctx->plane, &ctx->state, ctx->src, &ctx->fb, clip);
+	smi_damage_expect(ctx, clip, align);
+}
+
+static int smi_damage_test_init(struct kunit *test)
+{
+	struct smi_damage_ctx *ctx;
+
+	ctx = kunit_kzalloc(test, sizeof(*ctx), GFP_KERNEL);
+	if (!ctx)
+		return -ENOMEM;
+	ctx->seed = 0x5a17c0de;
+	ctx->saved_doublebuffer = use_doublebuffer;
+	use_doublebuffer = 0;
+	test->priv = ctx;
+	return 0;
+}
+
+static void smi_damage_test_exit(struct kunit *test)
+{
+	struct smi_damage_ctx *ctx = test->priv;
+
+	use_doublebuffer = ctx->saved_doublebuffer;
+	kvfree(ctx->shadow);
+	kvfree(ctx->vram[0]);
+	kvfree(ctx->vram[1]);
+	kvfree(ctx->expect);
+}
+
+static void smi_test_damage_full(struct kunit *test)
+{
+	struct smi_damage_ctx *ctx = test->priv;
+	struct drm_rect clip;
+
+	smi_damage_setup(test, DRM_FORMAT_XRGB8888, 1366, 768, 1366, 768, 0, 0);
+	drm_rect_init(&clip, 0, 0, 1366, 768);
+	smi_damage_upload(test, &clip, 0);
+	smi_damage_check(test, ctx->vram[0], &clip);
+}
+
+static void smi_test_damage_rgb565(struct kunit *test)
+{
+	struct smi_damage_ctx *ctx = test->priv;
+	struct drm_rect clip;
+
+	smi_damage_setup(test, DRM_FORMAT_RGB565, 800, 600, 800, 600, 0, 0);
+	drm_rect_init(&clip, 1, 1, 797, 3);
+	smi_damage_upload(test, &clip, 0);
+	smi_damage_check(test, ctx->vram[0], &clip);
+}
+
+static void smi_test_damage_panned(struct kunit *test)
+{
+	struct smi_damage_ctx *ctx = test->priv;
+	struct drm_rect clip;
+
+	/* 1024x768 window into a 1600x1200 fb */
+	smi_damage_setup(test, DRM_FORMAT_XRGB8888, 1600, 1200, 1024, 768, 333, 101);
+	drm_rect_init(&clip, 333, 101, 1024, 768);
+	smi_damage_upload(test, &clip, 0);
+	smi_damage_check(test, ctx->vram[0], &clip);
+}
+
+static void smi_test_damage_random(struct kunit *test)
+{
+	struct smi_damage_ctx *ctx = test->priv;
+	unsigned int sx = 17, sy = 9, w = 640, h = 480;
+	struct drm_rect clip;
+	int i;
+
+	smi_damage_setup(test, DRM_FORMAT_XRGB8888, 700, 500, w, h, sx, sy);
+	for (i = 0; i < 200; i++) {
+		int x1 = sx + smi_test_rand(ctx) % w, y1 = sy + smi_test_rand(ctx) % h;
+		int x2 = x1 + 1 + smi_test_rand(ctx) % (sx + w - x1);
+		int y2 = y1 + 1 + smi_test_rand(ctx) % (sy + h - y1);
+
+		drm_rect_init(&clip, x1, y1, x2 - x1, y2 - y1);
+		smi_damage_upload(test, &clip, 0);
+		smi_damage_check(test, ctx->vram[0], &clip);
+	}
+}
+
+static void smi_test_damage_doublebuffer(struct kunit *test)
+{
+	struct smi_damage_ctx *ctx = test->priv;
+	struct drm_rect clip;
+	int align;
+
+	/* SM770 panning by 65 pixels shifts the back buffer by 252 bytes */
+	smi_damage_setup(test, DRM_FORMAT_XRGB8888, 1024, 768, 800, 600, 65, 0);
+	align = smi_plane_line_align(SPC_SM770, 65, 4);
+	use_doublebuffer = 1;
+	ctx->plane.align = align;
+	ctx->plane.current_buffer = 1;
+	drm_rect_init(&clip, 100, 10, 200, 50);
+	smi_damage_upload(test, &clip, align);
+	smi_damage_check(test, ctx->vram[1], &clip);
+
+	/* the front buffer is untouched until the swap */
+	memset(ctx->expect, SMI_TEST_FILL, ctx->vram_size);
+	smi_damage_check(test, ctx->vram[0], &clip);
+}
+
+static void smi_test_damage_throughput(struct kunit *test)
+{
+	struct smi_damage_ctx *ctx = test->priv;
+	const unsigned int frames = 32;
+	struct drm_rect clip;
+	u64 bytes, ns, mbps;
+	unsigned int i;
+
+	smi_damage_setup(test, DRM_FORMAT_XRGB8888, 1280, 720, 1280, 720, 0, 0);
+	drm_rect_init(&clip, 0, 0, 1280, 720);
+	bytes = (u64)drm_rect_width(&clip) * drm_rect_height(&clip) * 4 * frames;
+
+	ns = ktime_get_ns();
+	for (i = 0; i < frames; i++)
+		smi_handle_damage(&ctx->plane, &ctx->state, ctx->src, &ctx->fb, &clip);
+	ns = max_t(u64, ktime_get_ns() - ns, 1);
+
+	mbps = div64_u64(bytes * NSEC_PER_SEC, ns) >> 20;
+	kunit_info(test, "%u frames, %llu bytes in %llu ns, %llu us/frame, %llu MB/s\n",
+		   frames, bytes, ns, div_u64(ns, frames * NSEC_PER_USEC), mbps);
+	KUNIT_EXPECT_GE(test, mbps, SMI_TEST_MIN_MBPS);
+
+	smi_damage_expect(ctx, &clip, 0);
+	smi_damage_check(test, ctx->vram[0], &clip);
+}
+
+static struct kunit_case smi_plane_test_cases[] = {
+	KUNIT_CASE(smi_test_align_line_offset),
+	KUNIT_CASE(smi_test_dc_offset),
+	KUNIT_CASE(smi_test_line_align),
+	KUNIT_CASE(smi_test_scanout_offset),
+	KUNIT_CASE(smi_test_damage_full),
+	KUNIT_CASE(smi_test_damage_rgb565),
+	KUNIT_CASE(smi_test_damage_panned),
+	KUNIT_CASE(smi_test_damage_random),
+	KUNIT_CASE(smi_test_damage_doublebuffer),
+	KUNIT_CASE(smi_test_damage_throughput),
+	{}
+};
+
+static struct kunit_suite smi_plane_test_suite = {
+	.name = "smi_plane",
+	.init = smi_damage_test_init,
+	.exit = smi_damage_test_exit,
+	.test_cases = smi_plane_test_cases,
+};
+
+kunit_test_suite(smi_plane_test_suite);
+
+#endif
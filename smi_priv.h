@@ -7,6 +7,30 @@ struct smi_mode_info {
 	/* pointer to fbdev info structure */
 };
 
+#define SMI_FLIP_BASE	BIT(0)
+#define SMI_FLIP_CURSOR	BIT(1)
+#define SMI_FLIP_LUT	BIT(2)
+
+/*
+ * Register updates of one commit. The planes and the gamma code record
+ * them, smi_crtc_atomic_flush() writes the latched base right away and
+ * cursor and LUT either too or from the next vsync interrupt, so they
+ * land in the same frame as the base.
+ */
+struct smi_flip {
+	spinlock_t lock;
+	unsigned int pending;	/* SMI_FLIP_* */
+	bool armed;		/* waiting for the vsync interrupt */
+	bool vblank_ref;	/* held for the interrupt, no event took it */
+	u64 vbl;		/* vblank count when the update started */
+	int base_ctrl, base_pitch, base_offset;
+	int cursor_ctrl;
+	unsigned long cursor_x, cursor_y;
+	unsigned char cursor_top, cursor_left;
+	unsigned int cursor_prefetch;	/* SM770 only */
+	int lut_ctrl;
+};
+
 struct smi_crtc {
 	struct drm_crtc base;
 	u8 lut_r[256], lut_g[256], lut_b[256];
@@ -14,6 +38,8 @@ struct smi_crtc {
 	bool enabled;
 	int crtc_index;
 	int CursorOffset;
+	bool fast_set;		/* last modeset only updated base/pitch */
+	struct smi_flip flip;
 };
 
 #endif
\ No newline at end of file
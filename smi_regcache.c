@@ -0,0 +1,291 @@
+// SPDX-License-Identifier: GPL-2.0+
+// Copyright (c) 2023, SiliconMotion Inc.
+
+#include <linux/bitmap.h>
+#include <linux/debugfs.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+
+#include "smi_drv.h"
+#include "smi_regs.h"
+
+/*
+ * Shadow register cache, built with regcache=1. Registers in the tables
+ * below are only ever changed by the driver, so a peek is served from the
+ * shadow and a poke writes through. Everything else, including the
+ * FB_ADDRESS pending bit, VSYNC status, current line, interrupt, I2C and
+ * DE status, goes to the chip as before.
+ */
+
+struct regcache_range {
+	u32 start;
+	u32 end;	/* exclusive */
+	u32 index;	/* first shadow slot, filled in at init */
+};
+
+/*
+ * Display channel registers shared by SM768 and SM770, relative to the
+ * channel. DISPLAY_CTRL is listed per chip: on SM768 bit 11 is the live
+ * VSYNC status that waitDispVerticalSync polls.
+ */
+#define REGCACHE_DC(base)					\
+	{ (base) + 0x80008, (base) + 0x80018 },	/* FB_WIDTH - VERTICAL_TOTAL */	\
+	{ (base) + 0x80030, (base) + 0x80040 },	/* HWC */		\
+	{ (base) + 0x80c00, (base) + 0x81000 }	/* PALETTE_RAM */
+#define REGCACHE_DISPLAY_CTRL(base)	{ (base) + 0x80000, (base) + 0x80004 }
+
+static struct regcache_range regcache_750[] = {
+	{ 0x80000, 0x8000c },	/* PRIMARY_DISPLAY_CTRL - COLOR_KEY */
+	{ 0x80010, 0x80030 },	/* PRIMARY_FB_WIDTH - VERTICAL_TOTAL */
+	{ 0x800f0, 0x80100 },	/* PRIMARY_HWC */
+	{ 0x80200, 0x80204 },	/* SECONDARY_DISPLAY_CTRL */
+	{ 0x80208, 0x80218 },	/* SECONDARY_FB_WIDTH - VERTICAL_TOTAL */
+	{ 0x80228, 0x8022c },	/* SECONDARY_SCALE */
+	{ 0x80230, 0x80240 },	/* SECONDARY_HWC */
+	{ 0x80400, 0x80800 },	/* PRIMARY_PALETTE_RAM */
+	{ 0x80c00, 0x81000 },	/* SECONDARY_PALETTE_RAM */
+};
+
+static struct regcache_range regcache_768[] = {
+	REGCACHE_DC(0),
+	REGCACHE_DC(0x8000),
+};
+
+static struct regcache_range regcache_770[] = {
+	REGCACHE_DISPLAY_CTRL(0),
+	REGCACHE_DISPLAY_CTRL(0x8000),
+	REGCACHE_DISPLAY_CTRL(0x18000),
+	REGCACHE_DC(0),
+	REGCACHE_DC(0x8000),
+	REGCACHE_DC(0x18000),
+};
+
+/* One shadow per card, found by the MMIO base the DDK passes in */
+#define REGCACHE_MAX_DEV	4
+
+struct regcache_dev {
+	volatile unsigned char __iomem *base;	/* NULL when the slot is free */
+	struct regcache_range *ranges;
+	int nranges;
+	u32 *shadow;
+	unsigned long *valid;
+	unsigned int size;	/* shadow slots */
+
+	u32 verify;		/* debugfs: read the chip too and compare */
+	u64 hits, misses, drift;
+};
+
+static struct regcache_dev regcache_devs[REGCACHE_MAX_DEV];
+static DEFINE_MUTEX(regcache_lock);	/* slots and the backend switch */
+static int regcache_users;
+
+static const struct smi_reg_ops *regcache_next;
+
+static struct regcache_dev *regcache_find(volatile unsigned char __iomem *base)
+{
+	int i;
+
+	if (!base)
+		return NULL;
+
+	for (i = 0; i < REGCACHE_MAX_DEV; i++) {
+		if (READ_ONCE(regcache_devs[i].base) == base)
+			return &regcache_devs[i];
+	}
+	return NULL;
+}
+
+/* Shadow slot of a dword register, -1 when it must go to the chip */
+static int regcache_slot(struct regcache_dev *rc, unsigned int offset)
+{
+	int i;
+
+	if (!rc || offset < 0x80000 || offset & 3)
+		return -1;
+
+	for (i = 0; i < rc->nranges; i++) {
+		if (offset >= rc->ranges[i].start && offset < rc->ranges[i].end)
+			return rc->ranges[i].index + (offset - rc->ranges[i].start) / 4;
+	}
+	return -1;
+}
+
+static u32 regcache_read32(volatile unsigned char __iomem *base, unsigned int offset)
+{
+	struct regcache_dev *rc = regcache_find(base);
+	int slot = regcache_slot(rc, offset);
+	u32 value;
+
+	if (slot < 0)
+		return regcache_next->read32(base, offset);
+
+	if (!test_bit(slot, rc->valid)) {
+		rc->misses++;
+		value = regcache_next->read32(base, offset);
+		WRITE_ONCE(rc->shadow[slot], value);
+		set_bit(slot, rc->valid);
+		return value;
+	}
+
+	rc->hits++;
+	value = READ_ONCE(rc->shadow[slot]);
+	if (rc->verify) {
+		u32 hw = regcache_next->read32(base, offset);
+
+		if (hw != value) {
+			rc->drift++;
+			pr_warn_ratelimited("regcache: 0x%06x is 0x%08x, shadow 0x%08x\n",
+					    offset, hw, value);
+			WRITE_ONCE(rc->shadow[slot], hw);
+			value = hw;
+		}
+	}
+	return value;
+}
+
+static void regcache_write32(volatile unsigned char __iomem *base, unsigned int offset, u32 value)
+{
+	struct regcache_dev *rc = regcache_find(base);
+	int slot = regcache_slot(rc, offset);
+
+	regcache_next->write32(base, offset, value);
+	if (slot < 0)
+		return;
+
+	WRITE_ONCE(rc->shadow[slot], value);
+	set_bit(slot, rc->valid);
+}
+
+static u8 regcache_read8(volatile unsigned char __iomem *base, unsigned int offset)
+{
+	return regcache_next->read8(base, offset);
+}
+
+/* Byte writes are rare, drop the dword and read it back next time */
+static void regcache_write8(volatile unsigned char __iomem *base, unsigned int offset, u8 value)
+{
+	struct regcache_dev *rc = regcache_find(base);
+	int slot = regcache_slot(rc, offset & ~3);
+
+	regcache_next->write8(base, offset, value);
+	if (slot >= 0)
+		clear_bit(slot, rc->valid);
+}
+
+static const struct smi_reg_ops regcache_ops = {
+	.read32 = regcache_read32,
+	.write32 = regcache_write32,
+	.read8 = regcache_read8,
+	.write8 = regcache_write8,
+};
+
+static void regcache_free(struct regcache_dev *rc)
+{
+	WRITE_ONCE(rc->base, NULL);
+	kvfree(rc->shadow);
+	bitmap_free(rc->valid);
+	memset(rc, 0, sizeof(*rc));
+}
+
+int smi_regcache_init(struct smi_device *sdev)
+{
+	struct regcache_dev *rc = NULL;
+	int i, ret = 0;
+
+	mutex_lock(&regcache_lock);
+	for (i = 0; i < REGCACHE_MAX_DEV && !rc; i++) {
+		if (!regcache_devs[i].base)
+			rc = &regcache_devs[i];
+	}
+	if (!rc || regcache_find(sdev->rmmio)) {
+		ret = -EBUSY;
+		goto out;
+	}
+
+	if (sdev->specId == SPC_SM750) {
+		rc->ranges = regcache_750;
+		rc->nranges = ARRAY_SIZE(regcache_750);
+	} else if (sdev->specId == SPC_SM768) {
+		rc->ranges = regcache_768;
+		rc->nranges = ARRAY_SIZE(regcache_768);
+	} else {
+		rc->ranges = regcache_770;
+		rc->nranges = ARRAY_SIZE(regcache_770);
+	}
+
+	/* the slot layout only depends on the table, filling it again is harmless */
+	for (i = 0; i < rc->nranges; i++) {
+		rc->ranges[i].index = rc->size;
+		rc->size += (rc->ranges[i].end - rc->ranges[i].start) / 4;
+	}
+
+	rc->shadow = kvcalloc(rc->size, sizeof(u32), GFP_KERNEL);
+	rc->valid = bitmap_zalloc(rc->size, GFP_KERNEL);
+	if (!rc->shadow || !rc->valid) {
+		regcache_free(rc);
+		ret = -ENOMEM;
+		goto out;
+	}
+	WRITE_ONCE(rc->base, sdev->rmmio);
+
+	/* a tracer may sit on top already, never wrap the cache in itself */
+	if (!regcache_users++ && smi_reg_ops != &regcache_ops) {
+		regcache_next = smi_reg_ops;
+		smi_set_reg_ops(&regcache_ops);
+	}
+out:
+	mutex_unlock(&regcache_lock);
+	return ret;
+}
+
+void smi_regcache_fini(struct smi_device *sdev)
+{
+	struct regcache_dev *rc;
+
+	mutex_lock(&regcache_lock);
+	rc = regcache_find(sdev->rmmio);
+	if (rc) {
+		regcache_free(rc);
+		if (!--regcache_users && smi_reg_ops == &regcache_ops)
+			smi_set_reg_ops(regcache_next);
+	}
+	mutex_unlock(&regcache_lock);
+}
+
+/* The chip lost its registers, e.g. across suspend */
+void smi_regcache_invalidate(struct smi_device *sdev)
+{
+	struct regcache_dev *rc = regcache_find(sdev->rmmio);
+
+	if (rc)
+		bitmap_zero(rc->valid, rc->size);
+}
+
+static int regcache_stats_show(struct seq_file *m, void *unused)
+{
+	struct regcache_dev *rc = m->private;
+
+	seq_printf(m, "registers: %u\n", rc->size);
+	seq_printf(m, "valid: %u\n", rc->valid ? bitmap_weight(rc->valid, rc->size) : 0);
+	seq_printf(m, "hits: %llu\n", rc->hits);
+	seq_printf(m, "misses: %llu\n", rc->misses);
+	seq_printf(m, "drift: %llu\n", rc->drift);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(regcache_stats);
+
+void smi_regcache_debugfs_init(struct smi_device *sdev, struct dentry *root)
+{
+	struct regcache_dev *rc = regcache_find(sdev->rmmio);
+	struct dentry *dir;
+
+	if (!rc)
+		return;
+
+	dir = debugfs_create_dir("regcache", root);
+	debugfs_create_u32("verify", S_IRUGO | S_IWUSR, dir, &rc->verify);
+	debugfs_create_file("stats", 0444, dir, rc, &regcache_stats_fops);
+}
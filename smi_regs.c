@@ -0,0 +1,38 @@
+// SPDX-License-Identifier: GPL-2.0+
+// Copyright (c) 2023, SiliconMotion Inc.
+
+#include "smi_regs.h"
+
+static u32 smi_mmio_read32(volatile unsigned char __iomem *base, unsigned int offset)
+{
+	return readl(base + offset);
+}
+
+static void smi_mmio_write32(volatile unsigned char __iomem *base, unsigned int offset, u32 value)
+{
+	writel(value, base + offset);
+}
+
+static u8 smi_mmio_read8(volatile unsigned char __iomem *base, unsigned int offset)
+{
+	return readb(base + offset);
+}
+
+static void smi_mmio_write8(volatile unsigned char __iomem *base, unsigned int offset, u8 value)
+{
+	writeb(value, base + offset);
+}
+
+static const struct smi_reg_ops smi_mmio_reg_ops = {
+	.read32 = smi_mmio_read32,
+	.write32 = smi_mmio_write32,
+	.read8 = smi_mmio_read8,
+	.write8 = smi_mmio_write8,
+};
+
+const struct smi_reg_ops *smi_reg_ops = &smi_mmio_reg_ops;
+
+void smi_set_reg_ops(const struct smi_reg_ops *ops)
+{
+	smi_reg_ops = ops ? ops : &smi_mmio_reg_ops;
+}
@@ -0,0 +1,73 @@
+// SPDX-License-Identifier: GPL-2.0+
+// Copyright (c) 2023, SiliconMotion Inc.
+
+#ifndef __SMI_REGS_H__
+#define __SMI_REGS_H__
+
+#include <linux/io.h>
+#include <linux/types.h>
+
+/*
+ * Register backend of the DDKs, used when the driver is built with
+ * regaccess=1 (USE_INTERNAL_REGISTER_ACCESS). Every peekRegisterDWord/
+ * pokeRegisterDWord and byte access of ddk750, ddk768 and ddk770 goes
+ * through these ops with the DDK's MMIO base, so an in-memory register
+ * model or a tracer can stand in for the PCI BAR.
+ */
+struct smi_reg_ops {
+	u32 (*read32)(volatile unsigned char __iomem *base, unsigned int offset);
+	void (*write32)(volatile unsigned char __iomem *base, unsigned int offset, u32 value);
+	u8 (*read8)(volatile unsigned char __iomem *base, unsigned int offset);
+	void (*write8)(volatile unsigned char __iomem *base, unsigned int offset, u8 value);
+};
+
+extern const struct smi_reg_ops *smi_reg_ops;
+
+/* NULL restores the MMIO backend */
+void smi_set_reg_ops(const struct smi_reg_ops *ops);
+
+struct dentry;
+struct smi_device;
+
+#ifdef SMI_REG_TRACE
+/* regtrace=1: debugfs regtrace/ wraps the backend above when enabled */
+void smi_regtrace_debugfs_init(struct dentry *root);
+void smi_regtrace_fini(void);
+#endif
+
+#ifdef SMI_REG_CACHE
+/* regcache=1: shadow of the registers only the driver writes */
+int smi_regcache_init(struct smi_device *sdev);
+void smi_regcache_fini(struct smi_device *sdev);
+void smi_regcache_invalidate(struct smi_device *sdev);
+void smi_regcache_debugfs_init(struct smi_device *sdev, struct dentry *root);
+#endif
+
+#ifdef SMI_REG_SIM
+/* regsim=1: memory backed register file for tests without a card */
+struct smi_regsim;
+
+struct smi_regsim_stats {
+	u64 reads;
+	u64 writes;
+	u64 oob;	/* accesses past the end of the model */
+};
+
+struct smi_regsim *smi_regsim_create(unsigned int size);
+void smi_regsim_destroy(struct smi_regsim *sim);
+void __iomem *smi_regsim_install(struct smi_regsim *sim);
+void smi_regsim_remove(struct smi_regsim *sim);
+int smi_regsim_script(struct smi_regsim *sim, unsigned int offset, u32 mask, u32 bits,
+		      unsigned int after, unsigned int period);
+unsigned int smi_regsim_script_reads(struct smi_regsim *sim, unsigned int offset);
+u32 smi_regsim_peek(struct smi_regsim *sim, unsigned int offset);
+void smi_regsim_poke(struct smi_regsim *sim, unsigned int offset, u32 value);
+void smi_regsim_stats(struct smi_regsim *sim, struct smi_regsim_stats *stats, bool reset);
+#endif
+
+#define SMI_REG_READ32(base, addr)		smi_reg_ops->read32((base), (addr))
+#define SMI_REG_WRITE32(base, addr, data)	smi_reg_ops->write32((base), (addr), (data))
+#define SMI_REG_READ8(base, addr)		smi_reg_ops->read8((base), (addr))
+#define SMI_REG_WRITE8(base, addr, data)	smi_reg_ops->write8((base), (addr), (data))
+
+#endif
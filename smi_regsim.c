@@ -0,0 +1,283 @@
+// SPDX-License-Identifier: GPL-2.0+
+// Copyright (c) 2023, SiliconMotion Inc.
+
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/vmalloc.h>
+
+#include "smi_regs.h"
+
+/*
+ * Memory backed register file, built with regsim=1. Once installed it
+ * replaces the register backend of all three DDKs: writes land in a plain
+ * buffer and reads return them, except for the status bits a test has
+ * scripted (DE idle, vsync, I2C done, HPD ...). Only one model can be
+ * installed at a time and it must not be installed while a device is bound.
+ */
+
+#define REGSIM_RULES	16
+
+struct regsim_rule {
+	bool used;
+	unsigned int offset;	/* dword aligned */
+	u32 mask;
+	u32 bits;
+	unsigned int after;	/* reads before the bits show up */
+	unsigned int period;	/* reads per phase once shown, 0 for steady */
+	unsigned int reads;
+};
+
+struct smi_regsim {
+	spinlock_t lock;
+	u8 *regs;
+	unsigned int size;
+	struct regsim_rule rules[REGSIM_RULES];
+	struct smi_regsim_stats stats;
+	const struct smi_reg_ops *saved;
+};
+
+static struct smi_regsim *regsim_active;
+
+static struct regsim_rule *regsim_rule(struct smi_regsim *sim, unsigned int offset)
+{
+	int i;
+
+	for (i = 0; i < REGSIM_RULES; i++)
+		if (sim->rules[i].used && sim->rules[i].offset == offset)
+			return &sim->rules[i];
+	return NULL;
+}
+
+/* dword at an aligned offset as the chip would return it, sim->lock held */
+static u32 regsim_load(struct smi_regsim *sim, unsigned int offset)
+{
+	struct regsim_rule *rule;
+	u32 value, bits;
+
+	if (offset + 4 > sim->size) {
+		sim->stats.oob++;
+		return 0xffffffff;
+	}
+
+	value = le32_to_cpup((__le32 *)(sim->regs + offset));
+	rule = regsim_rule(sim, offset);
+	if (!rule)
+		return value;
+
+	if (rule->reads++ < rule->after)
+		return value;
+
+	bits = rule->bits;
+	if (rule->period && ((rule->reads - 1 - rule->after) / rule->period) & 1)
+		bits = ~bits;
+	return (value & ~rule->mask) | (bits & rule->mask);
+}
+
+static void regsim_store(struct smi_regsim *sim, unsigned int offset, u32 value, u32 mask)
+{
+	__le32 *reg;
+
+	if (offset + 4 > sim->size) {
+		sim->stats.oob++;
+		return;
+	}
+
+	reg = (__le32 *)(sim->regs + offset);
+	*reg = cpu_to_le32((le32_to_cpup(reg) & ~mask) | (value & mask));
+}
+
+static u32 regsim_read32(volatile unsigned char __iomem *base, unsigned int offset)
+{
+	struct smi_regsim *sim = regsim_active;
+	unsigned long flags;
+	u32 value;
+
+	spin_lock_irqsave(&sim->lock, flags);
+	sim->stats.reads++;
+	value = regsim_load(sim, offset & ~3);
+	spin_unlock_irqrestore(&sim->lock, flags);
+
+	return value;
+}
+
+static void regsim_write32(volatile unsigned char __iomem *base, unsigned int offset, u32 value)
+{
+	struct smi_regsim *sim = regsim_active;
+	unsigned long flags;
+
+	spin_lock_irqsave(&sim->lock, flags);
+	sim->stats.writes++;
+	regsim_store(sim, offset & ~3, value, ~0U);
+	spin_unlock_irqrestore(&sim->lock, flags);
+}
+
+static u8 regsim_read8(volatile unsigned char __iomem *base, unsigned int offset)
+{
+	struct smi_regsim *sim = regsim_active;
+	unsigned long flags;
+	u32 value;
+
+	spin_lock_irqsave(&sim->lock, flags);
+	sim->stats.reads++;
+	value = regsim_load(sim, offset & ~3);
+	spin_unlock_irqrestore(&sim->lock, flags);
+
+	return value >> ((offset & 3) * 8);
+}
+
+static void regsim_write8(volatile unsigned char __iomem *base, unsigned int offset, u8 value)
+{
+	struct smi_regsim *sim = regsim_active;
+	unsigned int shift = (offset & 3) * 8;
+	unsigned long flags;
+
+	spin_lock_irqsave(&sim->lock, flags);
+	sim->stats.writes++;
+	regsim_store(sim, offset & ~3, (u32)value << shift, 0xffU << shift);
+	spin_unlock_irqrestore(&sim->lock, flags);
+}
+
+static const struct smi_reg_ops regsim_ops = {
+	.read32 = regsim_read32,
+	.write32 = regsim_write32,
+	.read8 = regsim_read8,
+	.write8 = regsim_write8,
+};
+
+struct smi_regsim *smi_regsim_create(unsigned int size)
+{
+	struct smi_regsim *sim;
+
+	sim = kzalloc(sizeof(*sim), GFP_KERNEL);
+	if (!sim)
+		return NULL;
+
+	sim->regs = vzalloc(size);
+	if (!sim->regs) {
+		kfree(sim);
+		return NULL;
+	}
+	sim->size = size;
+	spin_lock_init(&sim->lock);
+	return sim;
+}
+
+void smi_regsim_destroy(struct smi_regsim *sim)
+{
+	if (!sim)
+		return;
+	smi_regsim_remove(sim);
+	vfree(sim->regs);
+	kfree(sim);
+}
+
+/*
+ * Route all DDK register accesses to the model. Returns the buffer the
+ * DDK's mmio base should point to, or NULL if another model is installed.
+ */
+void __iomem *smi_regsim_install(struct smi_regsim *sim)
+{
+	if (regsim_active)
+		return NULL;
+
+	sim->saved = smi_reg_ops;
+	regsim_active = sim;
+	smi_set_reg_ops(&regsim_ops);
+	return (void __iomem *)sim->regs;
+}
+
+void smi_regsim_remove(struct smi_regsim *sim)
+{
+	if (regsim_active != sim)
+		return;
+
+	smi_set_reg_ops(sim->saved);
+	regsim_active = NULL;
+}
+
+/*
+ * Force the bits in mask of the register at offset to bits, once it has
+ * been read after times. With a period the forced bits invert every
+ * period reads, for status that toggles (vsync). Byte registers use
+ * their own offset and a byte mask. bits == mask with after == 0 is a
+ * bit that is always set. A new script for the same register replaces
+ * the old one and restarts its read count.
+ */
+int smi_regsim_script(struct smi_regsim *sim, unsigned int offset, u32 mask, u32 bits,
+		      unsigned int after, unsigned int period)
+{
+	unsigned int shift = (offset & 3) * 8;
+	struct regsim_rule *rule;
+	unsigned long flags;
+	int i, ret = 0;
+
+	if ((offset & ~3) + 4 > sim->size || (shift && (u64)mask << shift > U32_MAX))
+		return -EINVAL;
+
+	spin_lock_irqsave(&sim->lock, flags);
+	rule = regsim_rule(sim, offset & ~3);
+	for (i = 0; !rule && i < REGSIM_RULES; i++)
+		if (!sim->rules[i].used)
+			rule = &sim->rules[i];
+	if (rule) {
+		rule->used = true;
+		rule->offset = offset & ~3;
+		rule->mask = mask << shift;
+		rule->bits = bits << shift;
+		rule->after = after;
+		rule->period = period;
+		rule->reads = 0;
+	} else {
+		ret = -ENOSPC;
+	}
+	spin_unlock_irqrestore(&sim->lock, flags);
+
+	return ret;
+}
+
+/* reads the scripted register has seen, 0 if it is not scripted */
+unsigned int smi_regsim_script_reads(struct smi_regsim *sim, unsigned int offset)
+{
+	struct regsim_rule *rule;
+	unsigned long flags;
+	unsigned int reads;
+
+	spin_lock_irqsave(&sim->lock, flags);
+	rule = regsim_rule(sim, offset & ~3);
+	reads = rule ? rule->reads : 0;
+	spin_unlock_irqrestore(&sim->lock, flags);
+
+	return reads;
+}
+
+/* backdoor access, neither counted nor scripted */
+u32 smi_regsim_peek(struct smi_regsim *sim, unsigned int offset)
+{
+	if ((offset & ~3) + 4 > sim->size)
+		return 0xffffffff;
+	return le32_to_cpup((__le32 *)(sim->regs + (offset & ~3)));
+}
+
+void smi_regsim_poke(struct smi_regsim *sim, unsigned int offset, u32 value)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&sim->lock, flags);
+	regsim_store(sim, offset & ~3, value, ~0U);
+	spin_unlock_irqrestore(&sim->lock, flags);
+}
+
+void smi_regsim_stats(struct smi_regsim *sim, struct smi_regsim_stats *stats, bool reset)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&sim->lock, flags);
+	*stats = sim->stats;
+	if (reset)
+		memset(&sim->stats, 0, sizeof(sim->stats));
+	spin_unlock_irqrestore(&sim->lock, flags);
+}
+
+#ifdef SMI_KUNIT
+#include "smi_regsim_test.c"
+#endif
@@ -0,0 +1,245 @@
+// SPDX-License-Identifier: GPL-2.0+
+// Copyright (c) 2023, SiliconMotion Inc.
+
+/*
+ * KUnit runner for the register model, built into smi_regsim.c with
+ * "make regsim=1 kunit=1". It drives the SM768 DDK against the model:
+ * DE idle, I2C done, vsync and HPD polling with scripted status bits,
+ * then times a mode set and reports the register traffic it costs.
+ */
+
+#include <linux/version.h>
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 1, 0)
+
+#include <kunit/test.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+
+#include <drm/drm_modes.h>
+
+#include "ddk768/ddk768_mode.h"
+#include "ddk768/ddk768_help.h"
+#include "ddk768/ddk768_reg.h"
+#include "ddk768/ddk768_display.h"
+#include "ddk768/ddk768_2d.h"
+#include "ddk768/ddk768_hdmi.h"
+#include "ddk768/ddk768_hwi2c.h"
+#include "hw768.h"
+
+#define REGSIM_TEST_MODESETS	16
+
+/* the ddk750 and ddk770 help headers clash with ddk768's */
+extern volatile unsigned char __iomem *mmio750;
+extern volatile unsigned char __iomem *mmio770;
+
+struct regsim_test {
+	struct smi_regsim *sim;
+	volatile unsigned char __iomem *saved_mmio;
+};
+
+static int regsim_test_init(struct kunit *test)
+{
+	struct regsim_test *ctx;
+
+	/* the model replaces the backend of every device */
+	if (mmio750 || mmio768 || mmio770)
+		kunit_skip(test, "an SMI device is bound");
+
+	ctx = kunit_kzalloc(test, sizeof(*ctx), GFP_KERNEL);
+	if (!ctx)
+		return -ENOMEM;
+
+	ctx->sim = smi_regsim_create(SM768_PCI_ALLOC_MMIO_SIZE);
+	if (!ctx->sim)
+		return -ENOMEM;
+
+	ctx->saved_mmio = mmio768;
+	mmio768 = smi_regsim_install(ctx->sim);
+	if (!mmio768) {
+		smi_regsim_destroy(ctx->sim);
+		return -EBUSY;
+	}
+	test->priv = ctx;
+	return 0;
+}
+
+static void regsim_test_exit(struct kunit *test)
+{
+	struct regsim_test *ctx = test->priv;
+
+	if (!ctx)
+		return;
+	mmio768 = ctx->saved_mmio;
+	smi_regsim_destroy(ctx->sim);
+}
+
+static void regsim_test_backend(struct kunit *test)
+{
+	struct regsim_test *ctx = test->priv;
+	struct smi_regsim_stats stats;
+	int i;
+
+	pokeRegisterDWord(0x100, 0x11223344);
+	KUNIT_EXPECT_EQ(test, peekRegisterDWord(0x100), 0x11223344);
+	pokeRegisterByte(0x102, 0xaa);
+	KUNIT_EXPECT_EQ(test, peekRegisterDWord(0x100), 0x11aa3344);
+	KUNIT_EXPECT_EQ(test, peekRegisterByte(0x103), 0x11);
+	KUNIT_EXPECT_EQ(test, smi_regsim_peek(ctx->sim, 0x100), 0x11aa3344);
+
+	/* bit 0 shows up on the third read, then toggles every two reads */
+	KUNIT_ASSERT_EQ(test, smi_regsim_script(ctx->sim, 0x100, 0x1, 0x1, 2, 2), 0);
+	for (i = 0; i < 2; i++)
+		KUNIT_EXPECT_EQ(test, peekRegisterDWord(0x100) & 1, 0);
+	for (i = 0; i < 6; i++)
+		KUNIT_EXPECT_EQ(test, peekRegisterDWord(0x100) & 1, (i / 2 + 1) & 1);
+	KUNIT_EXPECT_EQ(test, smi_regsim_script_reads(ctx->sim, 0x100), 8);
+	/* scripting does not change what was written */
+	KUNIT_EXPECT_EQ(test, smi_regsim_peek(ctx->sim, 0x100), 0x11aa3344);
+
+	/* byte scripts land in their lane of the dword */
+	KUNIT_ASSERT_EQ(test, smi_regsim_script(ctx->sim, 0x101, 0x80, 0x80, 0, 0), 0);
+	KUNIT_EXPECT_EQ(test, peekRegisterByte(0x101), 0xb3);
+	KUNIT_EXPECT_EQ(test, smi_regsim_script(ctx->sim, 0x103, 0x100, 0, 0, 0), -EINVAL);
+
+	smi_regsim_stats(ctx->sim, &stats, true);
+	KUNIT_EXPECT_EQ(test, stats.oob, 0);
+	peekRegisterDWord(SM768_PCI_ALLOC_MMIO_SIZE);
+	pokeRegisterDWord(SM768_PCI_ALLOC_MMIO_SIZE, 0);
+	smi_regsim_stats(ctx->sim, &stats, false);
+	KUNIT_EXPECT_EQ(test, stats.reads, 1);
+	KUNIT_EXPECT_EQ(test, stats.writes, 1);
+	KUNIT_EXPECT_EQ(test, stats.oob, 2);
+}
+
+static void regsim_test_de_idle(struct kunit *test)
+{
+	struct regsim_test *ctx = test->priv;
+	u32 mask = FIELD_SET(0, DE_STATE2, DE_STATUS, BUSY) |
+		   FIELD_SET(0, DE_STATE2, DE_FIFO, NOTEMPTY) |
+		   FIELD_SET(0, DE_STATE2, DE_MEM_FIFO, EMPTY);
+	u32 idle = FIELD_SET(0, DE_STATE2, DE_STATUS, IDLE) |
+		   FIELD_SET(0, DE_STATE2, DE_FIFO, EMPTY) |
+		   FIELD_SET(0, DE_STATE2, DE_MEM_FIFO, EMPTY);
+
+	/* the reset value reads as memory FIFO not empty */
+	KUNIT_ASSERT_EQ(test, smi_regsim_script(ctx->sim, DE_STATE2, mask, idle, 100, 0), 0);
+	KUNIT_EXPECT_EQ(test, ddk768_deWaitForNotBusy(), 0);
+	KUNIT_EXPECT_EQ(test, smi_regsim_script_reads(ctx->sim, DE_STATE2), 101);
+
+	/* an engine that never goes idle times out instead of hanging */
+	KUNIT_ASSERT_EQ(test, smi_regsim_script(ctx->sim, DE_STATE2, mask, ~idle, 0, 0), 0);
+	KUNIT_EXPECT_EQ(test, ddk768_deWaitForNotBusy(), -1);
+	KUNIT_EXPECT_EQ(test, smi_regsim_script_reads(ctx->sim, DE_STATE2), 0x100000);
+}
+
+static void regsim_test_i2c_done(struct kunit *test)
+{
+	struct regsim_test *ctx = test->priv;
+	u32 done = FIELD_SET(0, I2C_STATUS, TX, COMPLETED);
+
+	KUNIT_ASSERT_EQ(test, smi_regsim_script(ctx->sim, I2C_STATUS, done, done, 5, 0), 0);
+	KUNIT_EXPECT_EQ(test, ddk768_hwI2CWriteReg(0, 0x51, 0x10, 0xab), 0);
+	/* I2C_CTRL shares the dword, so its read counts too */
+	KUNIT_EXPECT_GE(test, smi_regsim_script_reads(ctx->sim, I2C_STATUS), 6);
+	KUNIT_EXPECT_EQ(test, peekRegisterByte(I2C_SLAVE_ADDRESS), 0x50);
+	KUNIT_EXPECT_EQ(test, peekRegisterByte(I2C_DATA0), 0x10);
+	KUNIT_EXPECT_EQ(test, peekRegisterByte(I2C_DATA0 + 1), 0xab);
+
+	/* a transfer that never completes times out */
+	KUNIT_ASSERT_EQ(test, smi_regsim_script(ctx->sim, I2C_STATUS, done, 0, 0, 0), 0);
+	KUNIT_EXPECT_EQ(test, ddk768_hwI2CWriteReg(0, 0x51, 0x10, 0xab), -1);
+}
+
+static void regsim_test_vsync(struct kunit *test)
+{
+	struct regsim_test *ctx = test->priv;
+	u32 vsync = FIELD_SET(0, DISPLAY_CTRL, VSYNC, ACTIVE);
+	unsigned int toggling, stuck;
+
+	/* no pixel clock, no vsync to wait for */
+	KUNIT_ASSERT_EQ(test, smi_regsim_script(ctx->sim, DISPLAY_CTRL, vsync, vsync, 0, 3), 0);
+	waitDispVerticalSync(CHANNEL0_CTRL, 2);
+	KUNIT_EXPECT_EQ(test, smi_regsim_script_reads(ctx->sim, DISPLAY_CTRL), 0);
+
+	pokeRegisterDWord(CLOCK_ENABLE, FIELD_SET(0, CLOCK_ENABLE, DC0, ON));
+	pokeRegisterDWord(DISPLAY_CTRL, FIELD_SET(0, DISPLAY_CTRL, TIMING, ENABLE));
+	waitDispVerticalSync(CHANNEL0_CTRL, 2);
+	toggling = smi_regsim_script_reads(ctx->sim, DISPLAY_CTRL);
+
+	KUNIT_ASSERT_EQ(test, smi_regsim_script(ctx->sim, DISPLAY_CTRL, vsync, 0, 0, 0), 0);
+	waitDispVerticalSync(CHANNEL0_CTRL, 2);
+	stuck = smi_regsim_script_reads(ctx->sim, DISPLAY_CTRL);
+
+	kunit_info(test, "2 vsyncs: %u polls toggling, %u polls stuck\n", toggling, stuck);
+	KUNIT_EXPECT_GT(test, toggling, 2);
+	KUNIT_EXPECT_LT(test, toggling, stuck);
+}
+
+static void regsim_test_hpd(struct kunit *test)
+{
+	struct regsim_test *ctx = test->priv;
+	u32 mask = FIELD_VALUE(0, HDMI_CONFIG, DATA, HPG_MSENS);
+
+	/* HDMI registers are read back through the data field of HDMI_CONFIG */
+	KUNIT_ASSERT_EQ(test, smi_regsim_script(ctx->sim, HDMI_CONFIG, mask, mask, 0, 0), 0);
+	KUNIT_EXPECT_EQ(test, HDMI_hotplug_check(), 1);
+
+	KUNIT_ASSERT_EQ(test, smi_regsim_script(ctx->sim, HDMI_CONFIG, mask, 0, 0, 0), 0);
+	KUNIT_EXPECT_EQ(test, HDMI_hotplug_check(), 0);
+}
+
+static void regsim_test_modeset(struct kunit *test)
+{
+	struct regsim_test *ctx = test->priv;
+	struct drm_display_mode mode = {};
+	struct smi_regsim_stats stats;
+	logicalMode_t logicalMode;
+	u64 ns;
+	int i;
+
+	smi_regsim_stats(ctx->sim, &stats, true);
+	ns = ktime_get_ns();
+	for (i = 0; i < REGSIM_TEST_MODESETS; i++) {
+		memset(&logicalMode, 0, sizeof(logicalMode));
+		logicalMode.x = 1024;
+		logicalMode.y = 768;
+		logicalMode.bpp = 32;
+		logicalMode.hz = 60;
+		logicalMode.dispCtrl = CHANNEL0_CTRL;
+		KUNIT_ASSERT_EQ(test, ddk768_setMode(&logicalMode), 0);
+	}
+	ns = ktime_get_ns() - ns;
+	smi_regsim_stats(ctx->sim, &stats, false);
+
+	kunit_info(test, "1024x768@60: %llu us/modeset, %llu reads, %llu writes\n",
+		   div_u64(ns, REGSIM_TEST_MODESETS * NSEC_PER_USEC),
+		   div_u64(stats.reads, REGSIM_TEST_MODESETS),
+		   div_u64(stats.writes, REGSIM_TEST_MODESETS));
+	KUNIT_EXPECT_EQ(test, stats.oob, 0);
+
+	/* the timing the DDK wrote reads back as the same mode */
+	pokeRegisterDWord(VGA_CONFIGURATION, FIELD_SET(0, VGA_CONFIGURATION, MODE, GRAPHIC));
+	KUNIT_EXPECT_EQ(test, hw768_mode_unchanged(&logicalMode, mode), 1);
+}
+
+static struct kunit_case regsim_test_cases[] = {
+	KUNIT_CASE(regsim_test_backend),
+	KUNIT_CASE(regsim_test_de_idle),
+	KUNIT_CASE(regsim_test_i2c_done),
+	KUNIT_CASE(regsim_test_vsync),
+	KUNIT_CASE(regsim_test_hpd),
+	KUNIT_CASE(regsim_test_modeset),
+	{}
+};
+
+static struct kunit_suite regsim_test_suite = {
+	.name = "smi_regsim",
+	.init = regsim_test_init,
+	.exit = regsim_test_exit,
+	.test_cases = regsim_test_cases,
+};
+
+kunit_test_suite(regsim_test_suite);
+
+#endif
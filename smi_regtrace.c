@@ -0,0 +1,350 @@
+// SPDX-License-Identifier: GPL-2.0+
+// Copyright (c) 2023, SiliconMotion Inc.
+
+#include <linux/debugfs.h>
+#include <linux/hash.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/spinlock.h>
+
+#include "smi_regs.h"
+
+/*
+ * Register access tracer, built with regtrace=1. While debugfs
+ * regtrace/enable is 1 it sits in front of the register backend and
+ * records every DDK peek/poke: per register and per call site counts and
+ * time spent in the access, a read latency histogram and a ring of the
+ * last accesses. Reads are what stall the CPU, so the rankings sort by
+ * cumulative read time.
+ */
+
+#define REGTRACE_REG_BITS	10
+#define REGTRACE_SITE_BITS	9
+#define REGTRACE_RING_SIZE	4096	/* power of 2 */
+#define REGTRACE_HIST_BUCKETS	16	/* bucket n is [2^(n-1), 2^n) x 128ns */
+#define REGTRACE_TOP		32
+
+struct regtrace_stat {
+	bool used;
+	unsigned long key;	/* register offset or call site */
+	unsigned long site;	/* last call site, for registers */
+	u64 reads;
+	u64 writes;
+	u64 read_ns;
+	u64 write_ns;
+};
+
+struct regtrace_entry {
+	u64 ts;
+	unsigned long site;
+	u32 offset;
+	u32 value;
+	u32 ns;
+	u8 write;
+	u8 size;
+};
+
+static DEFINE_SPINLOCK(regtrace_lock);
+static struct regtrace_stat regtrace_regs[1 << REGTRACE_REG_BITS];
+static struct regtrace_stat regtrace_sites[1 << REGTRACE_SITE_BITS];
+static struct regtrace_entry regtrace_ring[REGTRACE_RING_SIZE];
+static unsigned int regtrace_head;
+static u64 regtrace_hist[REGTRACE_HIST_BUCKETS];
+static u64 regtrace_dropped;	/* accesses that found their table full */
+
+static const struct smi_reg_ops *regtrace_next;	/* backend being traced */
+static DEFINE_MUTEX(regtrace_enable_lock);	/* debugfs enable against fini */
+
+static struct regtrace_stat *regtrace_lookup(struct regtrace_stat *tab, int bits, unsigned long key)
+{
+	unsigned int i, n = 1U << bits;
+	unsigned int h = hash_long(key, bits);
+
+	for (i = 0; i < n; i++) {
+		struct regtrace_stat *s = &tab[(h + i) & (n - 1)];
+
+		if (!s->used) {
+			s->used = true;
+			s->key = key;
+			return s;
+		}
+		if (s->key == key)
+			return s;
+	}
+
+	regtrace_dropped++;
+	return NULL;
+}
+
+static void regtrace_record(unsigned int offset, u32 value, u8 size, bool write,
+			    u64 ns, unsigned long site)
+{
+	struct regtrace_stat *r, *s;
+	struct regtrace_entry *e;
+	unsigned long flags;
+
+	spin_lock_irqsave(&regtrace_lock, flags);
+
+	r = regtrace_lookup(regtrace_regs, REGTRACE_REG_BITS, offset);
+	s = regtrace_lookup(regtrace_sites, REGTRACE_SITE_BITS, site);
+	if (write) {
+		if (r) {
+			r->writes++;
+			r->write_ns += ns;
+		}
+		if (s) {
+			s->writes++;
+			s->write_ns += ns;
+		}
+	} else {
+		if (r) {
+			r->reads++;
+			r->read_ns += ns;
+		}
+		if (s) {
+			s->reads++;
+			s->read_ns += ns;
+		}
+		regtrace_hist[min_t(int, fls64(ns >> 7), REGTRACE_HIST_BUCKETS - 1)]++;
+	}
+	if (r)
+		r->site = site;
+
+	e = &regtrace_ring[regtrace_head++ & (REGTRACE_RING_SIZE - 1)];
+	e->ts = ktime_get_ns();
+	e->site = site;
+	e->offset = offset;
+	e->value = value;
+	e->ns = min_t(u64, ns, U32_MAX);
+	e->write = write;
+	e->size = size;
+
+	spin_unlock_irqrestore(&regtrace_lock, flags);
+}
+
+/* The DDK accessors are macros, so _RET_IP_ is the DDK call site */
+static u32 regtrace_read32(volatile unsigned char __iomem *base, unsigned int offset)
+{
+	u64 t = ktime_get_ns();
+	u32 value = regtrace_next->read32(base, offset);
+
+	regtrace_record(offset, value, 4, false, ktime_get_ns() - t, _RET_IP_);
+	return value;
+}
+
+static void regtrace_write32(volatile unsigned char __iomem *base, unsigned int offset, u32 value)
+{
+	u64 t = ktime_get_ns();
+
+	regtrace_next->write32(base, offset, value);
+	regtrace_record(offset, value, 4, true, ktime_get_ns() - t, _RET_IP_);
+}
+
+static u8 regtrace_read8(volatile unsigned char __iomem *base, unsigned int offset)
+{
+	u64 t = ktime_get_ns();
+	u8 value = regtrace_next->read8(base, offset);
+
+	regtrace_record(offset, value, 1, false, ktime_get_ns() - t, _RET_IP_);
+	return value;
+}
+
+static void regtrace_write8(volatile unsigned char __iomem *base, unsigned int offset, u8 value)
+{
+	u64 t = ktime_get_ns();
+
+	regtrace_next->write8(base, offset, value);
+	regtrace_record(offset, value, 1, true, ktime_get_ns() - t, _RET_IP_);
+}
+
+static const struct smi_reg_ops regtrace_ops = {
+	.read32 = regtrace_read32,
+	.write32 = regtrace_write32,
+	.read8 = regtrace_read8,
+	.write8 = regtrace_write8,
+};
+
+static int regtrace_enable_get(void *data, u64 *val)
+{
+	*val = smi_reg_ops == &regtrace_ops;
+	return 0;
+}
+
+static int regtrace_enable_set(void *data, u64 val)
+{
+	const struct smi_reg_ops *ops;
+
+	mutex_lock(&regtrace_enable_lock);
+	ops = smi_reg_ops;
+	if (val && ops != &regtrace_ops) {
+		regtrace_next = ops;
+		/* the tracer must see its backend before it is installed */
+		smp_wmb();
+		smi_set_reg_ops(&regtrace_ops);
+	} else if (!val && ops == &regtrace_ops) {
+		smi_set_reg_ops(regtrace_next);
+	}
+	mutex_unlock(&regtrace_enable_lock);
+	return 0;
+}
+DEFINE_SIMPLE_ATTRIBUTE(regtrace_enable_fops, regtrace_enable_get, regtrace_enable_set, "%llu\n");
+
+static int regtrace_cmp(const void *a, const void *b)
+{
+	const struct regtrace_stat *x = a, *y = b;
+
+	if (x->read_ns != y->read_ns)
+		return x->read_ns < y->read_ns ? 1 : -1;
+	if (x->reads + x->writes != y->reads + y->writes)
+		return x->reads + x->writes < y->reads + y->writes ? 1 : -1;
+	return 0;
+}
+
+/* Sorted copy of a table, the lock is not held while printing */
+static struct regtrace_stat *regtrace_snapshot(const struct regtrace_stat *tab, int bits)
+{
+	size_t size = sizeof(*tab) << bits;
+	struct regtrace_stat *snap;
+	unsigned long flags;
+
+	snap = kvmalloc(size, GFP_KERNEL);
+	if (!snap)
+		return NULL;
+
+	spin_lock_irqsave(&regtrace_lock, flags);
+	memcpy(snap, tab, size);
+	spin_unlock_irqrestore(&regtrace_lock, flags);
+
+	sort(snap, 1U << bits, sizeof(*snap), regtrace_cmp, NULL);
+	return snap;
+}
+
+static int regtrace_regs_show(struct seq_file *m, void *unused)
+{
+	struct regtrace_stat *snap;
+	int i;
+
+	snap = regtrace_snapshot(regtrace_regs, REGTRACE_REG_BITS);
+	if (!snap)
+		return -ENOMEM;
+
+	seq_puts(m, "offset     reads      writes     read_ns      avg_read_ns last_site\n");
+	for (i = 0; i < REGTRACE_TOP && snap[i].used; i++)
+		seq_printf(m, "0x%06lx %-10llu %-10llu %-12llu %-11llu %pS\n",
+			   snap[i].key, snap[i].reads, snap[i].writes, snap[i].read_ns,
+			   snap[i].reads ? div64_u64(snap[i].read_ns, snap[i].reads) : 0,
+			   (void *)snap[i].site);
+
+	kvfree(snap);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(regtrace_regs);
+
+static int regtrace_sites_show(struct seq_file *m, void *unused)
+{
+	struct regtrace_stat *snap;
+	int i;
+
+	snap = regtrace_snapshot(regtrace_sites, REGTRACE_SITE_BITS);
+	if (!snap)
+		return -ENOMEM;
+
+	seq_puts(m, "reads      writes     read_ns      write_ns     site\n");
+	for (i = 0; i < REGTRACE_TOP && snap[i].used; i++)
+		seq_printf(m, "%-10llu %-10llu %-12llu %-12llu %pS\n",
+			   snap[i].reads, snap[i].writes, snap[i].read_ns,
+			   snap[i].write_ns, (void *)snap[i].key);
+
+	kvfree(snap);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(regtrace_sites);
+
+static int regtrace_hist_show(struct seq_file *m, void *unused)
+{
+	int i;
+
+	for (i = 0; i < REGTRACE_HIST_BUCKETS; i++)
+		seq_printf(m, "%s%6uns: %llu\n", i == REGTRACE_HIST_BUCKETS - 1 ? ">=" : "< ",
+			   i == REGTRACE_HIST_BUCKETS - 1 ? 128U << (i - 1) : 128U << i,
+			   READ_ONCE(regtrace_hist[i]));
+	seq_printf(m, "dropped: %llu\n", READ_ONCE(regtrace_dropped));
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(regtrace_hist);
+
+/* Oldest access first */
+static int regtrace_log_show(struct seq_file *m, void *unused)
+{
+	struct regtrace_entry *ring;
+	unsigned int head, i, n;
+	unsigned long flags;
+
+	ring = kvmalloc(sizeof(regtrace_ring), GFP_KERNEL);
+	if (!ring)
+		return -ENOMEM;
+
+	spin_lock_irqsave(&regtrace_lock, flags);
+	memcpy(ring, regtrace_ring, sizeof(regtrace_ring));
+	head = regtrace_head;
+	spin_unlock_irqrestore(&regtrace_lock, flags);
+
+	n = min_t(unsigned int, head, REGTRACE_RING_SIZE);
+	for (i = head - n; i != head; i++) {
+		struct regtrace_entry *e = &ring[i & (REGTRACE_RING_SIZE - 1)];
+
+		seq_printf(m, "%llu %c%u 0x%06x 0x%08x %uns %pS\n", e->ts,
+			   e->write ? 'W' : 'R', e->size * 8, e->offset, e->value,
+			   e->ns, (void *)e->site);
+	}
+
+	kvfree(ring);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(regtrace_log);
+
+static ssize_t regtrace_reset_write(struct file *file, const char __user *user_data,
+				    size_t cnt, loff_t *lt)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&regtrace_lock, flags);
+	memset(regtrace_regs, 0, sizeof(regtrace_regs));
+	memset(regtrace_sites, 0, sizeof(regtrace_sites));
+	memset(regtrace_hist, 0, sizeof(regtrace_hist));
+	regtrace_head = 0;
+	regtrace_dropped = 0;
+	spin_unlock_irqrestore(&regtrace_lock, flags);
+
+	return cnt;
+}
+
+static const struct file_operations regtrace_reset_fops = {
+	.owner = THIS_MODULE,
+	.open  = simple_open,
+	.write = regtrace_reset_write,
+};
+
+void smi_regtrace_debugfs_init(struct dentry *root)
+{
+	struct dentry *dir = debugfs_create_dir("regtrace", root);
+
+	debugfs_create_file("enable", 0644, dir, NULL, &regtrace_enable_fops);
+	debugfs_create_file("regs", 0444, dir, NULL, &regtrace_regs_fops);
+	debugfs_create_file("sites", 0444, dir, NULL, &regtrace_sites_fops);
+	debugfs_create_file("hist", 0444, dir, NULL, &regtrace_hist_fops);
+	debugfs_create_file("log", 0444, dir, NULL, &regtrace_log_fops);
+	debugfs_create_file("reset", 0200, dir, NULL, &regtrace_reset_fops);
+}
+
+/* Put the traced backend back before the module goes away */
+void smi_regtrace_fini(void)
+{
+	regtrace_enable_set(NULL, 0);
+}
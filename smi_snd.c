@@ -13,10 +13,13 @@
 #include <linux/uaccess.h>
 #include <linux/jiffies.h>
 #include <linux/timer.h>
+#include <linux/ktime.h>
+#include <linux/pm_runtime.h>
 
 
 
 #include "smi_snd.h"
+#include <sound/info.h>
 #include "ddk768/uda1345.h"
 #include "ddk768/wm8978.h"
 #include "ddk768/ddk768_reg.h"
@@ -30,10 +33,17 @@
 
 #include "hw768.h"
 #include "hw770.h"
+#include "smi_trace.h"
 
 
-struct sm768chip *chip_irq_id=NULL;/*chip_irq_id is use for request and free irq*/
 int use_wm8978 = 0;
+/* current I2S sample rate and SRAM section size, shared by playback and capture */
+static unsigned long smi_audio_rate = 48000;
+static unsigned long smi_audio_section = SRAM_SECTION_SIZE;
+
+static const unsigned int smi_audio_rate_candidates[] = {
+	32000, 44100, 48000, 88200, 96000, 176400, 192000,
+};
 static inline void memcpy32_fromio(void *dst, const void __iomem *src, int count)
 {
 	/* __ioread32_copy uses 32-bit count values so divide by 4 for
@@ -53,7 +63,7 @@ static inline void memcpy32_toio(void __iomem *dst, const void *src, int count)
 static int SMI_AudioInit(struct smi_device *sdev, unsigned long wordLength)
 {
 
-	int sample_rate = 48000;
+	int sample_rate;
 
 	// Init audio codec
 	if(sdev->specId == SPC_SM768)
@@ -82,11 +92,12 @@ static int SMI_AudioInit(struct smi_device *sdev, unsigned long wordLength)
 			sample_rate = 48000;
 		else
 			sample_rate = 44100;
+		smi_audio_rate = sample_rate;
 
        	// Set up I2S and GPIO registers to transmit/receive data.
         iisOpen(wordLength, sample_rate);
-		//Set I2S to DMA 256 DWord from SRAM starting at location 0 of SRAM
-		iisTxDmaSetup(0,SRAM_SECTION_SIZE);
+		//Set I2S to DMA one section at a time from SRAM starting at location 0 of SRAM
+		iisTxDmaSetup(0, smi_audio_section);
 
 	}
 	else if(sdev->specId == SPC_SM770)
@@ -101,7 +112,7 @@ static int SMI_AudioInit(struct smi_device *sdev, unsigned long wordLength)
 			} 
 		}
 
-		hw770_AudioInit(wordLength, sample_rate);
+		hw770_AudioInit(wordLength, smi_audio_rate, smi_audio_section);
 	}
 
     return 0;
@@ -198,6 +209,185 @@ static int SMI_AudioDeinit(struct smi_device *sdev)
 	return 0;
 }
 
+/*
+ * Reclock I2S for a new sample rate and resize the SRAM sections, one
+ * I2S DMA session (and interrupt) per section. On SM770 this also
+ * recomputes the HDMI N/CTS, see hw770_AudioInit(). SM768 only runs at
+ * the rate its crystal gives.
+ */
+static int SMI_AudioSetup(struct smi_device *sdev, unsigned long rate,
+			  unsigned long section)
+{
+	if (rate == smi_audio_rate && section == smi_audio_section)
+		return 0;
+
+	if (sdev->specId != SPC_SM770 && rate != smi_audio_rate)
+		return -EINVAL;
+
+	dbg_msg("audio rate %lu -> %lu, section %lu -> %lu\n",
+		smi_audio_rate, rate, smi_audio_section, section);
+
+	SMI_AudioStop(sdev);
+	smi_audio_rate = rate;
+	smi_audio_section = section;
+	if (sdev->specId == SPC_SM770) {
+		hw770_AudioInit(SAMPLE_BITS, rate, section);
+	} else {
+		iisOpen(SAMPLE_BITS, rate);
+		iisTxDmaSetup(0, section);
+	}
+	SMI_AudioStart(sdev);
+
+	return 0;
+}
+
+/* Fill the list of sample rates advertised to ALSA */
+static void snd_falconi2s_rates_init(struct sm768chip *chip)
+{
+	unsigned int count = 0;
+	int i;
+
+	if (chip->chipId == SPC_SM770) {
+		for (i = 0; i < ARRAY_SIZE(smi_audio_rate_candidates); i++) {
+			if (hw770_AudioRateValid(SAMPLE_BITS, smi_audio_rate_candidates[i]))
+				chip->rates[count++] = smi_audio_rate_candidates[i];
+		}
+	}
+
+	if (count == 0)
+		chip->rates[count++] = smi_audio_rate;
+
+	chip->rate_list.count = count;
+	chip->rate_list.list = chip->rates;
+	chip->rate_list.mask = 0;
+}
+
+/* HDMI/DP sinks in hw770 route bit order, with their connector bits */
+static const int smi_audio_sink_use[SMI_AUDIO_SINKS] = {
+	USE_HDMI0, USE_HDMI1, USE_HDMI2, USE_DP0, USE_DP1,
+};
+
+/*
+ * LPCM rates of a sink as a mask in smi_audio_rate_candidates order,
+ * which is also the rate bit order of a CEA short audio descriptor.
+ * 0 when the sink has no ELD.
+ */
+static unsigned int snd_smi_eld_rates(const u8 *eld)
+{
+	const u8 *sad = drm_eld_sad(eld);
+	unsigned int mask = 0;
+	int i;
+
+	if (!sad)
+		return 0;
+
+	for (i = 0; i < drm_eld_sad_count(eld); i++, sad += 3) {
+		/* 16 bit LPCM, the only format the I2S DMA carries */
+		if (((sad[0] >> 3) & 0xf) == HDMI_AUDIO_CODING_TYPE_PCM &&
+		    (sad[2] & 0x1))
+			mask |= sad[1] & 0x7f;
+	}
+
+	return mask;
+}
+
+/*
+ * Narrow the playback rates to those every routed and connected sink
+ * plays natively. Sinks without an ELD do not restrict anything, and
+ * the full list is kept if the sinks have no rate in common.
+ */
+static void snd_falconi2s_sink_rates_init(struct sm768chip *chip)
+{
+	struct smi_device *sdev = chip->sdev;
+	unsigned int route, rates, mask = ~0U;
+	unsigned int count = 0;
+	unsigned long flags;
+	int i, j;
+
+	chip->sink_rate_list = chip->rate_list;
+
+	if (chip->chipId != SPC_SM770)
+		return;
+
+	route = hw770_AudioGetRoute();
+
+	spin_lock_irqsave(&sdev->eld_lock, flags);
+	for (i = 0; i < SMI_AUDIO_SINKS; i++) {
+		if (!(route & (1 << i)) ||
+		    !(sdev->m_connector & smi_audio_sink_use[i]))
+			continue;
+
+		rates = snd_smi_eld_rates(sdev->eld[i]);
+		if (rates)
+			mask &= rates;
+	}
+	spin_unlock_irqrestore(&sdev->eld_lock, flags);
+
+	for (i = 0; i < chip->rate_list.count; i++) {
+		for (j = 0; j < ARRAY_SIZE(smi_audio_rate_candidates); j++) {
+			if (chip->rates[i] == smi_audio_rate_candidates[j] &&
+			    (mask & (1 << j)))
+				chip->sink_rates[count++] = chip->rates[i];
+		}
+	}
+
+	if (count == 0)
+		return;
+
+	chip->sink_rate_list.count = count;
+	chip->sink_rate_list.list = chip->sink_rates;
+}
+
+/*
+ * Playback and capture share the I2S clock and the SRAM sections. A
+ * second stream has to use the rate the first one is running at, and a
+ * period that maps onto the same section size.
+ *
+ * Periods up to P_PERIOD_BYTE are one SRAM section each, small ones for
+ * low latency. Larger periods keep 1KB sections and signal a period
+ * every few interrupts, for fewer wakeups.
+ */
+static int snd_falconi2s_constraints(struct snd_pcm_substream *substream)
+{
+	struct sm768chip *chip = snd_pcm_substream_chip(substream);
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct snd_pcm_hw_constraint_list *rate_list = &chip->rate_list;
+	struct snd_pcm_substream *other;
+	int err;
+
+	other = (substream->stream == SNDRV_PCM_STREAM_PLAYBACK) ?
+		chip->capture_substream : chip->play_substream;
+
+	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK && !other) {
+		snd_falconi2s_sink_rates_init(chip);
+		rate_list = &chip->sink_rate_list;
+	}
+
+	runtime->hw.rates = SNDRV_PCM_RATE_KNOT;
+	runtime->hw.rate_min = rate_list->list[0];
+	runtime->hw.rate_max = rate_list->list[rate_list->count - 1];
+
+	if (other) {
+		runtime->hw.rate_min = smi_audio_rate;
+		runtime->hw.rate_max = smi_audio_rate;
+
+		if (smi_audio_section < P_PERIOD_BYTE)
+			runtime->hw.period_bytes_max = smi_audio_section;
+		runtime->hw.period_bytes_min = smi_audio_section;
+	}
+
+	err = snd_pcm_hw_constraint_list(runtime, 0, SNDRV_PCM_HW_PARAM_RATE,
+					 rate_list);
+	if (err < 0)
+		return err;
+
+	err = snd_pcm_hw_constraint_pow2(runtime, 0, SNDRV_PCM_HW_PARAM_PERIOD_BYTES);
+	if (err < 0)
+		return err;
+
+	return snd_pcm_hw_constraint_integer(runtime, SNDRV_PCM_HW_PARAM_PERIODS);
+}
+
 static u8  VolAuDrvToCodec(u16 audrv)
 {
 	u8 codecdb,map;
@@ -346,6 +536,105 @@ static struct snd_kcontrol_new falconi2s_vol[] = {
 		.private_value = 0,
 },
 };
+
+/*
+ * SM770 sink routing. There is one I2S stream, these switches pick the
+ * HDMI/DP encoders it is played on.
+ */
+static int snd_falconi2s_get_route(struct snd_kcontrol *kcontrol,
+				   struct snd_ctl_elem_value *ucontrol)
+{
+	ucontrol->value.integer.value[0] =
+		!!(hw770_AudioGetRoute() & kcontrol->private_value);
+
+	return 0;
+}
+
+static int snd_falconi2s_put_route(struct snd_kcontrol *kcontrol,
+				   struct snd_ctl_elem_value *ucontrol)
+{
+	unsigned int route = hw770_AudioGetRoute();
+	unsigned int new_route;
+
+	if (ucontrol->value.integer.value[0])
+		new_route = route | kcontrol->private_value;
+	else
+		new_route = route & ~kcontrol->private_value;
+
+	if (new_route == route)
+		return 0;
+
+	hw770_AudioRoute(new_route);
+
+	return 1;
+}
+
+#define SMI_ROUTE_SWITCH(xname, xbit) \
+{ \
+		.iface = SNDRV_CTL_ELEM_IFACE_MIXER, \
+		.name = xname " Playback Switch", \
+		.info = snd_ctl_boolean_mono_info, \
+		.get = snd_falconi2s_get_route, \
+		.put = snd_falconi2s_put_route, \
+		.private_value = xbit, \
+}
+
+static struct snd_kcontrol_new smi770_route[] = {
+	SMI_ROUTE_SWITCH("HDMI0", 1 << 0),
+	SMI_ROUTE_SWITCH("HDMI1", 1 << 1),
+	SMI_ROUTE_SWITCH("HDMI2", 1 << 2),
+	SMI_ROUTE_SWITCH("DP0", 1 << 3),
+	SMI_ROUTE_SWITCH("DP1", 1 << 4),
+};
+
+/* sink ELDs, indexed like the route switches, empty while unplugged */
+static int snd_falconi2s_eld_info(struct snd_kcontrol *kcontrol,
+				  struct snd_ctl_elem_info *uinfo)
+{
+	uinfo->type = SNDRV_CTL_ELEM_TYPE_BYTES;
+	uinfo->count = MAX_ELD_BYTES;
+
+	return 0;
+}
+
+static int snd_falconi2s_get_eld(struct snd_kcontrol *kcontrol,
+				 struct snd_ctl_elem_value *ucontrol)
+{
+	struct sm768chip *chip = kcontrol->private_data;
+	struct smi_device *sdev = chip->sdev;
+	int sink = kcontrol->private_value;
+	unsigned long flags;
+
+	memset(ucontrol->value.bytes.data, 0, MAX_ELD_BYTES);
+
+	spin_lock_irqsave(&sdev->eld_lock, flags);
+	if (sdev->m_connector & smi_audio_sink_use[sink])
+		memcpy(ucontrol->value.bytes.data, sdev->eld[sink],
+		       min_t(int, drm_eld_size(sdev->eld[sink]), MAX_ELD_BYTES));
+	spin_unlock_irqrestore(&sdev->eld_lock, flags);
+
+	return 0;
+}
+
+#define SMI_ELD(xsink) \
+{ \
+		.access = SNDRV_CTL_ELEM_ACCESS_READ | \
+			  SNDRV_CTL_ELEM_ACCESS_VOLATILE, \
+		.iface = SNDRV_CTL_ELEM_IFACE_PCM, \
+		.name = "ELD", \
+		.index = xsink, \
+		.info = snd_falconi2s_eld_info, \
+		.get = snd_falconi2s_get_eld, \
+		.private_value = xsink, \
+}
+
+static struct snd_kcontrol_new smi770_eld[] = {
+	SMI_ELD(0),
+	SMI_ELD(1),
+	SMI_ELD(2),
+	SMI_ELD(3),
+	SMI_ELD(4),
+};
   
 /* hardware definition */
 static struct snd_pcm_hardware snd_falconi2s_playback_hw = {
@@ -362,8 +651,8 @@ static struct snd_pcm_hardware snd_falconi2s_playback_hw = {
 	.channels_max = 2,
 	//actually total length should less than 4096*1024.
 	.buffer_bytes_max = P_PERIOD_BYTE * P_PERIOD_MAX,
-	.period_bytes_min = P_PERIOD_BYTE,
-	.period_bytes_max = P_PERIOD_BYTE,
+	.period_bytes_min = P_PERIOD_BYTE_MIN,
+	.period_bytes_max = P_PERIOD_BYTE_MAX,
 	.periods_min =	  P_PERIOD_MIN,
 	.periods_max =	  P_PERIOD_MAX,
 };
@@ -382,8 +671,8 @@ static struct snd_pcm_hardware snd_falconi2s_capture_hw = {
 	.channels_max = 2,
 	//actually total length should less than 4096*1024.
 	.buffer_bytes_max = P_PERIOD_BYTE * P_PERIOD_MAX,
-	.period_bytes_min = P_PERIOD_BYTE,
-	.period_bytes_max = P_PERIOD_BYTE,
+	.period_bytes_min = P_PERIOD_BYTE_MIN,
+	.period_bytes_max = P_PERIOD_BYTE_MAX,
 	.periods_min =	  P_PERIOD_MIN,
 	.periods_max =	  P_PERIOD_MAX,
 
@@ -394,13 +683,20 @@ static int snd_falconi2s_playback_open(struct snd_pcm_substream *substream)
 {
 	struct sm768chip *chip = snd_pcm_substream_chip(substream);
 	struct snd_pcm_runtime *runtime = substream->runtime;
+	int err;
 	dbg_msg("snd_falconi2s_playback_open\n");
 
 	
 	runtime->hw = snd_falconi2s_playback_hw;
+	err = snd_falconi2s_constraints(substream);
+	if (err < 0)
+		return err;
 	/* set the pointer value of substream field in the chip record at 
 	 * open callback to hold the current running substream pointer */
 	chip->play_substream = substream;
+
+	/* keep the display clocks running while the stream is open */
+	pm_runtime_get_sync(chip->dev);
 	
 	return 0;
 }
@@ -413,6 +709,8 @@ static int snd_falconi2s_playback_close(struct snd_pcm_substream *substream)
 	dbg_msg("snd_falconi2s_playback_close\n");
 	/* reset the pointer value of substream field in the chip record at close callback */
 	chip->play_substream = NULL;			 
+	pm_runtime_mark_last_busy(chip->dev);
+	pm_runtime_put_autosuspend(chip->dev);
 	return 0;
 
 }
@@ -422,11 +720,16 @@ static int snd_falconi2s_capture_open(struct snd_pcm_substream *substream)
 {
 	struct sm768chip *chip = snd_pcm_substream_chip(substream);
 	struct snd_pcm_runtime *runtime = substream->runtime;
+	int err;
 
 	runtime->hw = snd_falconi2s_capture_hw;
+	err = snd_falconi2s_constraints(substream);
+	if (err < 0)
+		return err;
 
 	/* set the pointer value of substream field in the chip record at open callback to hold the current running substream pointer */
 	chip->capture_substream = substream;
+	pm_runtime_get_sync(chip->dev);
 
 	
 	return 0;
@@ -439,6 +742,8 @@ static int snd_falconi2s_capture_close(struct snd_pcm_substream *substream)
 	/* the hardware-specific codes will be here */
 	/* reset the pointer value of substream field in the chip record at close callback */
 	chip->capture_substream = NULL;
+	pm_runtime_mark_last_busy(chip->dev);
+	pm_runtime_put_autosuspend(chip->dev);
 	return 0;
 
 }
@@ -447,7 +752,16 @@ static int snd_falconi2s_capture_close(struct snd_pcm_substream *substream)
 static int snd_falconi2s_pcm_hw_params(struct snd_pcm_substream *substream,
                                struct snd_pcm_hw_params *hw_params)
 {
+	struct sm768chip *chip = snd_pcm_substream_chip(substream);
+	struct drm_device *dev = dev_get_drvdata(chip->dev);
+	int err;
+
 	dbg_msg("snd_falconi2s_pcm_hw_params,malloc:%d\n",params_buffer_bytes(hw_params));
+
+	err = SMI_AudioSetup(dev->dev_private, params_rate(hw_params),
+			     min_t(unsigned int, params_period_bytes(hw_params), P_PERIOD_BYTE));
+	if (err < 0)
+		return err;
 	   
 	return snd_pcm_lib_malloc_pages(substream,
                                      params_buffer_bytes(hw_params));
@@ -470,10 +784,12 @@ static int snd_falconi2s_pcm_prepare(struct snd_pcm_substream *substream)
 	dbg_msg("snd_falconi2s_pcm_prepare\n");
 
 	
-	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK) {
 		chip->ppointer = 0;
-	else
+		chip->pqueued = 0;
+	} else {
 		chip->cpointer = 0;
+	}
 	
 
 	dbg_msg("runtime->rate:%d\n",runtime->rate);
@@ -548,17 +864,48 @@ static int snd_falconi2s_pcm_playback_trigger(struct snd_pcm_substream *substrea
 
 
 
+static unsigned long snd_smi_dma_pointer(struct sm768chip *chip)
+{
+	return (chip->chipId == SPC_SM770) ? ddk770_iisDmaPointer() : iisDmaPointer();
+}
+
+/*
+ * Section the I2S DMA is working on. At the end of a session the pointer
+ * still reads the last DWord of the finished section, hence the +1.
+ */
+static int snd_smi_dma_section(unsigned long dmaPointer)
+{
+	return ((dmaPointer + 1) * 4 / smi_audio_section) % SRAM_SECTIONS(smi_audio_section);
+}
+
   /* pointer callback */
   static snd_pcm_uframes_t
 snd_falconi2s_pcm_pointer(struct snd_pcm_substream *substream)
 {
 	struct sm768chip *chip = snd_pcm_substream_chip(substream);
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	unsigned long section = smi_audio_section;
+	unsigned long dmaPointer, played, queued, pos;
 	snd_pcm_uframes_t value = 0;
 
-	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
-		value = bytes_to_frames(substream->runtime, chip->ppointer);
-	else
-		value = bytes_to_frames(substream->runtime, chip->cpointer);
+	if (substream->stream != SNDRV_PCM_STREAM_PLAYBACK) {
+		/* recorded data only reaches the buffer a section at a time */
+		return bytes_to_frames(runtime, chip->cpointer);
+	}
+
+	/*
+	 * ppointer is where the next section will be copied from. Step back
+	 * over what is still waiting in SRAM to get the byte being played.
+	 */
+	dmaPointer = snd_smi_dma_pointer(chip);
+	played = ((dmaPointer + 1) * 4) % section;
+	queued = chip->pqueued;
+	if (queued > section)
+		queued -= played;
+	queued = min(queued, (unsigned long)runtime->dma_bytes);
+
+	pos = (chip->ppointer + runtime->dma_bytes - queued) % runtime->dma_bytes;
+	value = bytes_to_frames(runtime, pos);
 	
 	return value;
 }
@@ -592,9 +939,18 @@ static struct snd_pcm_ops snd_falconi2s_capture_ops = {
 
 static int snd_falconi2s_free(struct sm768chip *chip)
 {
+	struct smi_device *sdev = chip->sdev;
+
 	/* will be implemented later... */
 	dbg_msg("snd_falconi2s_free!\n");
 
+	/* stop smi_irq_handler calling into this chip */
+	if (sdev && sdev->audio_data == chip) {
+		WRITE_ONCE(sdev->audio_irq, NULL);
+		synchronize_irq(chip->irq);
+		sdev->audio_data = NULL;
+	}
+
 	return 0;
 }
 
@@ -607,16 +963,34 @@ static int snd_falconi2s_dev_free(struct snd_device *device)
 }
 
 
+static void snd_smi_stats_hist(unsigned long *hist, u64 ns)
+{
+	hist[min_t(int, fls(div_u64(ns, 16 * NSEC_PER_USEC)), SMI_AUDIO_HIST_BUCKETS - 1)]++;
+}
+
+static void snd_smi_stats_copy(struct smi_audio_stats *stats, int stream,
+			       int section, u64 start)
+{
+	u64 ns = ktime_get_ns() - start;
+
+	stats->copy_ns_max = max(stats->copy_ns_max, ns);
+	snd_smi_stats_hist(stats->copy_hist, ns);
+	trace_smi_audio_copy(stream, section, smi_audio_section, ns);
+}
+
 static int snd_smi_play_copy_data(struct sm768chip *chip,int sramTxSection)
 {
 	struct snd_pcm_substream *play_substream;
 	struct snd_pcm_runtime *play_runtime;
+	struct smi_audio_stats *stats;
+	unsigned long section = smi_audio_section;
+	u64 start;
 
 	play_substream = chip->play_substream;
 
 	if (play_substream == NULL) {
 		memset32((void *)((unsigned long)chip->pvReg + SRAM_OUTPUT_BASE) +
-			 SRAM_SECTION_SIZE * sramTxSection, 0x00, P_PERIOD_BYTE / 4);
+			 section * sramTxSection, 0x00, section / 4);
 		return 0;
 	}
 
@@ -630,11 +1004,26 @@ static int snd_smi_play_copy_data(struct sm768chip *chip,int sramTxSection)
 
 	if (play_runtime->dma_bytes == 0)
 		return 0;
-	memcpy32_toio(chip->pvReg + SRAM_OUTPUT_BASE + SRAM_SECTION_SIZE * sramTxSection,
-		      play_runtime->dma_area + chip->ppointer, P_PERIOD_BYTE);
-		chip->ppointer+= P_PERIOD_BYTE;
+
+	stats = &chip->stats[SNDRV_PCM_STREAM_PLAYBACK];
+	if (snd_pcm_playback_hw_avail(play_runtime) < bytes_to_frames(play_runtime, section))
+		stats->xruns++;
+
+	start = ktime_get_ns();
+	memcpy32_toio(chip->pvReg + SRAM_OUTPUT_BASE + section * sramTxSection,
+		      play_runtime->dma_area + chip->ppointer, section);
+	snd_smi_stats_copy(stats, SNDRV_PCM_STREAM_PLAYBACK, sramTxSection, start);
+	if (snd_smi_dma_section(snd_smi_dma_pointer(chip)) == sramTxSection)
+		stats->mismatches++;
+
+		chip->ppointer+= section;
 	chip->ppointer %= play_runtime->dma_bytes;
+	/* the section being played plus the one just filled */
+	chip->pqueued = min(chip->pqueued + section, 2 * section);
+	if (chip->ppointer % snd_pcm_lib_period_bytes(play_substream) == 0) {
+		stats->periods++;
 		snd_pcm_period_elapsed(play_substream);
+	}
 	return 0;
 }
 
@@ -642,12 +1031,15 @@ static int snd_smi_capture_copy_data(struct sm768chip *chip,int sramTxSection)
 {
 	struct snd_pcm_substream *capture_substream;
 	struct snd_pcm_runtime *capture_runtime;
+	struct smi_audio_stats *stats;
+	unsigned long section = smi_audio_section;
+	u64 start;
 
 	capture_substream = chip->capture_substream;
 
 	if (capture_substream == NULL) {
 		memset32((void *)((unsigned long)chip->pvReg + SRAM_INPUT_BASE +
-			 SRAM_SECTION_SIZE * sramTxSection), 0x00, P_PERIOD_BYTE / 4);
+			 section * sramTxSection), 0x00, section / 4);
 		return 0;
 	}
 		
@@ -662,73 +1054,75 @@ static int snd_smi_capture_copy_data(struct sm768chip *chip,int sramTxSection)
 	if (capture_runtime->dma_bytes == 0)
 		return 0;
 
+	stats = &chip->stats[SNDRV_PCM_STREAM_CAPTURE];
+	if (snd_pcm_capture_avail(capture_runtime) + bytes_to_frames(capture_runtime, section) >
+	    capture_runtime->buffer_size)
+		stats->xruns++;
+
+	start = ktime_get_ns();
 	memcpy32_fromio(capture_runtime->dma_area + chip->cpointer,
-			chip->pvReg + SRAM_INPUT_BASE + SRAM_SECTION_SIZE * sramTxSection,
-			P_PERIOD_BYTE);
-		chip->cpointer+= P_PERIOD_BYTE;
+			chip->pvReg + SRAM_INPUT_BASE + section * sramTxSection,
+			section);
+	snd_smi_stats_copy(stats, SNDRV_PCM_STREAM_CAPTURE, sramTxSection, start);
+	if (snd_smi_dma_section(snd_smi_dma_pointer(chip)) == sramTxSection)
+		stats->mismatches++;
+
+		chip->cpointer+= section;
 	chip->cpointer %= capture_runtime->dma_bytes;
+	if (chip->cpointer % snd_pcm_lib_period_bytes(capture_substream) == 0) {
+		stats->periods++;
 		snd_pcm_period_elapsed(capture_substream);
+	}
 	return 0;
 }
 
 
 /*
- * interrupt handler
+ * Called at the end of every DMA session. Playback fills the section
+ * after the one now playing, capture drains the one just recorded.
+ * With two sections both are the same section, as before.
  */
-static irqreturn_t snd_smi770_interrupt(int irq, void *dev_id)
+static void snd_smi_copy_data(struct sm768chip *chip, unsigned long dmaPointer)
 {
-	
-	struct sm768chip *chip = dev_id;
-
-	int sramTxSection;
-
-	if (chip == NULL)
-		return IRQ_NONE;
-	if (!hw770_check_iis_interrupt()) {
-		return IRQ_NONE;
+	int sections = SRAM_SECTIONS(smi_audio_section);
+	int cur = snd_smi_dma_section(dmaPointer);
+	struct smi_audio_stats *stats;
+	u64 latency;
+	int i;
+
+	/* how far the DMA got into the new section, as time at 4 bytes a frame */
+	latency = div_u64((u64)(((dmaPointer + 1) * 4) % smi_audio_section) * NSEC_PER_SEC,
+			  smi_audio_rate * 4);
+	for (i = 0; i < 2; i++) {
+		if (!(i == SNDRV_PCM_STREAM_PLAYBACK ? chip->play_substream : chip->capture_substream))
+			continue;
+		stats = &chip->stats[i];
+		stats->irqs++;
+		stats->latency_ns_max = max(stats->latency_ns_max, latency);
+		snd_smi_stats_hist(stats->latency_hist, latency);
 	}
-	ddk770_iisClearRawInt(); //clear int
-
-	/* SRAM is logically divided into 2 portions (1024 byte each).
-	 * Check I2S DMA pointer to find out which portion is active.
-	 */
-	sramTxSection = (ddk770_iisDmaPointer() >= 255) ? 0 : 1;
 
-	snd_smi_play_copy_data(chip, sramTxSection);
-	snd_smi_capture_copy_data(chip, sramTxSection);
-
-	return IRQ_HANDLED;
+	snd_smi_play_copy_data(chip, (cur + 1) % sections);
+	snd_smi_capture_copy_data(chip, (cur + sections - 1) % sections);
 }
 
-
-
-
 /*
- * interrupt handler
+ * I2S interrupt, called from smi_irq_handler once it has seen the I2S
+ * source pending.
  */
-static irqreturn_t snd_smi_interrupt(int irq, void *dev_id)
+static void snd_smi_interrupt(void *data)
 {
-	struct sm768chip *chip = dev_id;
-	int sramTxSection;
-
-	if (chip == NULL)
-		return IRQ_NONE;
-
-	if (!hw768_check_iis_interrupt())
-		return IRQ_NONE;
-
-	iisClearRawInt();
-
-	/* SRAM is logically divided into 2 portions (1024 byte each).
-	 * Check I2S DMA pointer to find out which portion is active.
-	 */
-	sramTxSection = (iisDmaPointer() >= 255) ? 0 : 1;
+	struct sm768chip *chip = data;
 
-	snd_smi_play_copy_data(chip, sramTxSection);
-	snd_smi_capture_copy_data(chip, sramTxSection);
-
-	return IRQ_HANDLED;
+	if (chip->chipId == SPC_SM770) {
+		ddk770_iisClearRawInt();
+		snd_smi_copy_data(chip, ddk770_iisDmaPointer());
+	} else {
+		iisClearRawInt();
+		snd_smi_copy_data(chip, iisDmaPointer());
+	}
 }
+
   /* chip-specific constructor
    * (see "Management of Cards and Components")
    */
@@ -754,6 +1148,8 @@ static int snd_falconi2s_create(struct snd_card *card,
 		return -ENOMEM;
 
 	chip->card = card;
+	chip->dev = dev->dev;
+	chip->sdev = smi_device;
 
 	err = snd_device_new(card, SNDRV_DEV_LOWLEVEL, chip, &ops);
 	if (err < 0) {
@@ -781,7 +1177,7 @@ static int snd_falconi2s_create(struct snd_card *card,
 	dbg_msg("Audio video memory virtual addr = %p\n",chip->pvMem);
 
 
-	chip->irq = pdev->irq;
+	chip->irq = smi_device->irq;
 
 	dbg_msg("Audio pci irq :%d\n",chip->irq);
 	
@@ -795,36 +1191,24 @@ static int snd_falconi2s_create(struct snd_card *card,
 	//clear SRAM
 	memset32((void *)((unsigned long)chip->pvReg + SRAM_OUTPUT_BASE), 0, SRAM_TOTAL_SIZE/4);
 	
-	chip_irq_id=chip;/*Record chip_irq_id which will use in free_irq*/
-	dbg_msg("chip_irq_id=%p\n", chip_irq_id);
+	if (!smi_device->irq_enabled) {
+		dev_err(&pdev->dev, "no IRQ for the I2S interrupt\n");
+		snd_falconi2s_free(chip);
+		return -EBUSY;
+	}
+
+	//The interrupt moves more data from DDR to SRAM.
+	smi_device->audio_data = chip;
+	WRITE_ONCE(smi_device->audio_irq, snd_smi_interrupt);
 
 	if(smi_device->specId == SPC_SM770){
 		ddk770_iisClearRawInt();
-
-	//Setup ISR. The ISR will move more data from DDR to SRAM.
-		if (request_irq(pdev->irq, snd_smi770_interrupt, IRQF_SHARED,
-			KBUILD_MODNAME, chip_irq_id)) {
-			dev_err(&pdev->dev, "unable to grab IRQ %d\n", pdev->irq);
-			snd_falconi2s_free(chip);
-			return -EBUSY;
-		}
-
 		ddk770_sb_IRQUnmask(21);
-	
 	}else{
 		iisClearRawInt();//clear int
-		//Setup ISR. The ISR will move more data from DDR to SRAM.
-	if (request_irq(pdev->irq, snd_smi_interrupt, IRQF_SHARED,
-		KBUILD_MODNAME, chip_irq_id)) {
-		dev_err(&pdev->dev, "unable to grab IRQ %d\n", pdev->irq);
-		snd_falconi2s_free(chip);
-		return -EBUSY;
-	}
-	sb_IRQUnmask(SB_IRQ_VAL_I2S); 
+		sb_IRQUnmask(SB_IRQ_VAL_I2S);
 	}
 
-		
-
 #if LINUX_VERSION_CODE <= KERNEL_VERSION(3,18,0)
 	snd_card_set_dev(card, &pdev->dev);
 #endif
@@ -835,6 +1219,38 @@ static int snd_falconi2s_create(struct snd_card *card,
 
 
 
+/* /proc/asound/cardX/stats */
+static void snd_falconi2s_proc_read(struct snd_info_entry *entry,
+				    struct snd_info_buffer *buffer)
+{
+	static const char * const names[2] = { "playback", "capture" };
+	struct sm768chip *chip = entry->private_data;
+	struct smi_audio_stats *stats;
+	int i, j;
+
+	snd_iprintf(buffer, "rate %lu, section %lu bytes, %lu sections\n",
+		    smi_audio_rate, smi_audio_section, SRAM_SECTIONS(smi_audio_section));
+	snd_iprintf(buffer, "histogram buckets: <16 <32 <64 <128 <256 <512 <1024 >=1024 us\n");
+
+	for (i = 0; i < 2; i++) {
+		stats = &chip->stats[i];
+		snd_iprintf(buffer, "%s: irqs %lu periods %lu xruns %lu mismatches %lu\n",
+			    names[i], stats->irqs, stats->periods, stats->xruns, stats->mismatches);
+
+		snd_iprintf(buffer, "  irq latency max %llu us:",
+			    div_u64(stats->latency_ns_max, NSEC_PER_USEC));
+		for (j = 0; j < SMI_AUDIO_HIST_BUCKETS; j++)
+			snd_iprintf(buffer, " %lu", stats->latency_hist[j]);
+		snd_iprintf(buffer, "\n");
+
+		snd_iprintf(buffer, "  copy max %llu us:",
+			    div_u64(stats->copy_ns_max, NSEC_PER_USEC));
+		for (j = 0; j < SMI_AUDIO_HIST_BUCKETS; j++)
+			snd_iprintf(buffer, " %lu", stats->copy_hist[j]);
+		snd_iprintf(buffer, "\n");
+	}
+}
+
 int smi_audio_init(struct drm_device *dev)
 {
 	int idx, err;
@@ -868,6 +1284,8 @@ int smi_audio_init(struct drm_device *dev)
       		return err;
 	}
 
+	snd_falconi2s_rates_init(chip);
+
 	strcpy(card->driver, "smi-audio");
 	strcpy(card->shortname, "smi-audio");
 	strcpy(card->longname, "SiliconMotion Audio");
@@ -888,7 +1306,7 @@ int smi_audio_init(struct drm_device *dev)
 #else
 					      snd_dma_pci_data(pdev),
 #endif
-						P_PERIOD_BYTE*P_PERIOD_MIN, P_PERIOD_BYTE*P_PERIOD_MAX);
+						P_BUFFER_PREALLOC, P_PERIOD_BYTE*P_PERIOD_MAX);
 
 	strcpy(card->mixername, "SiliconMotion Audio Mixer Control");
 	
@@ -899,7 +1317,32 @@ int smi_audio_init(struct drm_device *dev)
 		}
 	}
 
+	if (sdev->specId == SPC_SM770) {
+		for (idx = 0; idx < ARRAY_SIZE(smi770_route); idx++) {
+			err = snd_ctl_add(card, snd_ctl_new1(&smi770_route[idx], chip));
+			if (err < 0)
+				return err;
+		}
+
+		for (idx = 0; idx < ARRAY_SIZE(smi770_eld); idx++) {
+			err = snd_ctl_add(card, snd_ctl_new1(&smi770_eld[idx], chip));
+			if (err < 0)
+				return err;
+		}
+	}
+
 	
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 0, 0)
+	snd_card_ro_proc_new(card, "stats", chip, snd_falconi2s_proc_read);
+#else
+	{
+		struct snd_info_entry *entry;
+
+		if (!snd_card_proc_new(card, "stats", &entry))
+			snd_info_set_text_ops(entry, chip, snd_falconi2s_proc_read);
+	}
+#endif
+
 	err = snd_card_register(card);
 	if (err < 0) {
 		snd_card_free(card);
@@ -914,18 +1357,9 @@ int smi_audio_init(struct drm_device *dev)
 
 void smi_audio_remove(struct drm_device *dev)
 {
-	struct pci_dev *pdev;
 	struct smi_device *sdev = dev->dev_private;
 	struct snd_card *card = sdev->card;
 
-
-	pdev = to_pci_dev(dev->dev);
-	
-	dbg_msg("perpare to free irq, pci irq:%u, chip_irq_id=0x%p\n", pdev->irq, chip_irq_id);
-	if(pdev->irq){				
-		free_irq(pdev->irq, chip_irq_id);
-		dbg_msg("free irq\n");
-	}
 	SMI_AudioStop(sdev);
 	SMI_AudioDeinit(sdev);
 
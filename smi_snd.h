@@ -13,9 +13,27 @@
 #include <sound/initval.h>
 #include <sound/pcm.h>
 
+#define SMI_AUDIO_HIST_BUCKETS	8	/* <16us, <32us, ... <1024us, >=1024us */
+
+/* per-stream audio statistics, updated from the I2S interrupt */
+struct smi_audio_stats {
+	unsigned long irqs;
+	unsigned long periods;
+	unsigned long xruns;		/* section copied without enough data */
+	unsigned long mismatches;	/* DMA already in the section being copied */
+	u64 latency_ns_max;		/* section boundary to handler */
+	u64 copy_ns_max;		/* SRAM copy */
+	unsigned long latency_hist[SMI_AUDIO_HIST_BUCKETS];
+	unsigned long copy_hist[SMI_AUDIO_HIST_BUCKETS];
+};
+
+struct smi_device;
+
 /* definition of the chip-specific record */
 struct sm768chip {
 	struct snd_card *card;
+	struct device *dev;
+	struct smi_device *sdev;
 	int irq;
 
     int chipId;
@@ -24,6 +42,7 @@ struct sm768chip {
 	struct snd_pcm_substream *capture_substream;
 	unsigned long ppointer;
 	unsigned long cpointer;
+	unsigned long pqueued;	/* playback bytes in SRAM not yet played */
 	
 	void __iomem *pvReg;
 	void __iomem *pvMem;
@@ -40,6 +59,17 @@ struct sm768chip {
 	u8 capture_vol;
 	u8 playback_switch;//only record one channel, right=left
 	u8 capture_switch;
+
+	//indexed by SNDRV_PCM_STREAM_PLAYBACK/CAPTURE
+	struct smi_audio_stats stats[2];
+
+	//sample rates the I2S clock can produce exactly
+	unsigned int rates[8];
+	struct snd_pcm_hw_constraint_list rate_list;
+
+	//rates above that the routed sinks accept, from their ELDs
+	unsigned int sink_rates[8];
+	struct snd_pcm_hw_constraint_list sink_rate_list;
 	
 };
 
@@ -60,9 +90,12 @@ struct sm768_runtime_data {
 #endif
 
 /* For playback hw parameter*/
-#define P_PERIOD_BYTE 		  1024
-#define P_PERIOD_MIN 		  16
+#define P_PERIOD_BYTE 		  1024	/* largest SRAM section, one I2S DMA session */
+#define P_PERIOD_BYTE_MIN 	  128	/* smallest SRAM section */
+#define P_PERIOD_BYTE_MAX 	  (P_PERIOD_BYTE * 16)
+#define P_PERIOD_MIN 		  2
 #define P_PERIOD_MAX 		  256
+#define P_BUFFER_PREALLOC 	  (P_PERIOD_BYTE * 16)
 
 #define FEATURES	          2/* 1:only output; 2:output and input */
 #define SRAM_TOTAL_SIZE	  	  0x1000
@@ -76,6 +109,8 @@ struct sm768_runtime_data {
 #define SRAM_SECTION_SIZE     (SRAM_OUTPUT_SIZE/OUTPUT_SRAM_SECTIONS_NUM)
 #define SRAM_SECTION_SIZE_DWORDS  ((SRAM_SECTION_SIZE/4)-1)
 #define OUTPUT_SRAM_SECTIONS_NUM  SECTIONS_NUM
+/* The DMA only wraps at the end of SRAM, so the sections always tile it */
+#define SRAM_SECTIONS(size)	  (SRAM_OUTPUT_SIZE/(size))
 
 
 #endif				/* __SMI_DRV_H__ */
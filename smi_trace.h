@@ -0,0 +1,177 @@
+// SPDX-License-Identifier: GPL-2.0+
+// Copyright (c) 2023, SiliconMotion Inc.
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM smifb
+
+#if !defined(_SMI_TRACE_H_) || defined(TRACE_HEADER_MULTI_READ)
+#define _SMI_TRACE_H_
+
+#include <linux/tracepoint.h>
+#include <linux/types.h>
+#include <linux/version.h>
+
+TRACE_EVENT(smi_plane_check,
+	TP_PROTO(unsigned int plane, int crtc, int ret),
+	TP_ARGS(plane, crtc, ret),
+	TP_STRUCT__entry(
+		__field(unsigned int, plane)
+		__field(int, crtc)
+		__field(int, ret)
+	),
+	TP_fast_assign(
+		__entry->plane = plane;
+		__entry->crtc = crtc;
+		__entry->ret = ret;
+	),
+	TP_printk("plane=%u crtc=%d ret=%d", __entry->plane, __entry->crtc, __entry->ret)
+);
+
+TRACE_EVENT(smi_plane_update,
+	TP_PROTO(int dc, unsigned int fb, int x, int y),
+	TP_ARGS(dc, fb, x, y),
+	TP_STRUCT__entry(
+		__field(int, dc)
+		__field(unsigned int, fb)
+		__field(int, x)
+		__field(int, y)
+	),
+	TP_fast_assign(
+		__entry->dc = dc;
+		__entry->fb = fb;
+		__entry->x = x;
+		__entry->y = y;
+	),
+	TP_printk("dc=%d fb=%u src=%d,%d", __entry->dc, __entry->fb, __entry->x, __entry->y)
+);
+
+TRACE_EVENT(smi_damage,
+	TP_PROTO(int dc, int x1, int y1, int x2, int y2, unsigned int bytes, u64 ns),
+	TP_ARGS(dc, x1, y1, x2, y2, bytes, ns),
+	TP_STRUCT__entry(
+		__field(int, dc)
+		__field(int, x1)
+		__field(int, y1)
+		__field(int, x2)
+		__field(int, y2)
+		__field(unsigned int, bytes)
+		__field(u64, ns)
+	),
+	TP_fast_assign(
+		__entry->dc = dc;
+		__entry->x1 = x1;
+		__entry->y1 = y1;
+		__entry->x2 = x2;
+		__entry->y2 = y2;
+		__entry->bytes = bytes;
+		__entry->ns = ns;
+	),
+	TP_printk("dc=%d rect=%d,%d-%d,%d bytes=%u ns=%llu", __entry->dc,
+		  __entry->x1, __entry->y1, __entry->x2, __entry->y2,
+		  __entry->bytes, __entry->ns)
+);
+
+TRACE_EVENT(smi_set_base,
+	TP_PROTO(int dc, unsigned int pitch, unsigned int offset),
+	TP_ARGS(dc, pitch, offset),
+	TP_STRUCT__entry(
+		__field(int, dc)
+		__field(unsigned int, pitch)
+		__field(unsigned int, offset)
+	),
+	TP_fast_assign(
+		__entry->dc = dc;
+		__entry->pitch = pitch;
+		__entry->offset = offset;
+	),
+	TP_printk("dc=%d pitch=%u offset=0x%x", __entry->dc, __entry->pitch, __entry->offset)
+);
+
+TRACE_EVENT(smi_crtc_flush,
+	TP_PROTO(int crtc, bool event),
+	TP_ARGS(crtc, event),
+	TP_STRUCT__entry(
+		__field(int, crtc)
+		__field(bool, event)
+	),
+	TP_fast_assign(
+		__entry->crtc = crtc;
+		__entry->event = event;
+	),
+	TP_printk("crtc=%d event=%d", __entry->crtc, __entry->event)
+);
+
+TRACE_EVENT(smi_vblank,
+	TP_PROTO(int crtc),
+	TP_ARGS(crtc),
+	TP_STRUCT__entry(
+		__field(int, crtc)
+	),
+	TP_fast_assign(
+		__entry->crtc = crtc;
+	),
+	TP_printk("crtc=%d", __entry->crtc)
+);
+
+TRACE_EVENT(smi_hpd,
+	TP_PROTO(int port, int status),
+	TP_ARGS(port, status),
+	TP_STRUCT__entry(
+		__field(int, port)
+		__field(int, status)
+	),
+	TP_fast_assign(
+		__entry->port = port;
+		__entry->status = status;
+	),
+	TP_printk("hdmi=%d status=0x%x", __entry->port, __entry->status)
+);
+
+TRACE_EVENT(smi_edid_read,
+	TP_PROTO(const char *connector, bool valid, u64 ns),
+	TP_ARGS(connector, valid, ns),
+	TP_STRUCT__entry(
+		__string(connector, connector)
+		__field(bool, valid)
+		__field(u64, ns)
+	),
+	TP_fast_assign(
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 10, 0)
+		__assign_str(connector);
+#else
+		__assign_str(connector, connector);
+#endif
+		__entry->valid = valid;
+		__entry->ns = ns;
+	),
+	TP_printk("%s valid=%d ns=%llu", __get_str(connector), __entry->valid, __entry->ns)
+);
+
+TRACE_EVENT(smi_audio_copy,
+	TP_PROTO(int stream, int section, unsigned int bytes, u64 ns),
+	TP_ARGS(stream, section, bytes, ns),
+	TP_STRUCT__entry(
+		__field(int, stream)
+		__field(int, section)
+		__field(unsigned int, bytes)
+		__field(u64, ns)
+	),
+	TP_fast_assign(
+		__entry->stream = stream;
+		__entry->section = section;
+		__entry->bytes = bytes;
+		__entry->ns = ns;
+	),
+	TP_printk("%s section=%d bytes=%u ns=%llu",
+		  __entry->stream ? "capture" : "playback",
+		  __entry->section, __entry->bytes, __entry->ns)
+);
+
+#endif /* _SMI_TRACE_H_ */
+
+/* This part must be outside protection */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE smi_trace
+#include <trace/define_trace.h>